@@ -0,0 +1,148 @@
+#include <JuceHeader.h>
+#include "../Source/AdaptiveCurveTable.h"
+#include "../Source/CurveFunction.h"
+#include "../Source/ProgramCurve.h"
+#include "CurveEngine.h"
+
+/**
+ * A curve, exact, baked or played as the plugin plays a program, with its controller mapping baked alongside: the 128
+ * results are worked out once so that 7-bit batches cost one table read a value. Never changed after it is handed out.
+ */
+struct mt_curve {
+    // The ranges of the plugin's curves (see MidiTransformerPluginProcessor)
+    mt_curve() :
+        curve (0.0f, 127.0f, 0.0f, 127.0f) { }
+
+    float compute(float input) const noexcept {
+        if (program != nullptr)
+            return program->compute (input);
+        return table != nullptr ? table->compute (input) : curve.compute (input);
+    }
+
+    /** As transformMidi() writes a controller: truncated, then clamped to 0-127 */
+    void bakeControllerTable() {
+        for (int i = 0; i < 128; i++)
+            controllerTable[(size_t) i] = static_cast<uint8> (jlimit (0, 127, static_cast<int> (compute (static_cast<float> (i)))));
+    }
+
+    aas::CurveFunction<float> curve;
+    std::unique_ptr<aas::AdaptiveCurveTable> table;
+    // A stored program, baked as MidiTransformerPluginProcessor bakes it, so that it maps every input as the plugin does
+    std::unique_ptr<aas::ProgramCurve> program;
+    std::array<uint8, 128> controllerTable{};
+};
+
+namespace
+{
+    /** The reverse of AudioProcessor::copyXmlToBinary(), which is in juce_audio_processors */
+    std::unique_ptr<XmlElement> getXmlFromBinary(const void* data, size_t size) {
+        const uint32 magicXmlNumber = 0x21324356;
+        if (data == nullptr || size <= 8 || ByteOrder::littleEndianInt (data) != magicXmlNumber)
+            return nullptr;
+        const auto stringLength = static_cast<size_t> (ByteOrder::littleEndianInt (static_cast<const char*> (data) + 4));
+        if (stringLength == 0)
+            return nullptr;
+        const auto numBytes = jmin (size - 8, stringLength, static_cast<size_t> (std::numeric_limits<int>::max()));
+        return parseXML (String::fromUTF8 (static_cast<const char*> (data) + 8, static_cast<int> (numBytes)));
+    }
+
+    const XmlElement* findCurveState(const XmlElement& state, int program) {
+        if (program == MT_CURVE_LIVE)
+            return state.getChildByName ("curveState");
+        if (auto* programs = state.getChildByName ("programs"))
+            for (auto* programState = programs->getChildByName ("program"); programState != nullptr; programState = programState->getNextElementWithTagName ("program"))
+                if (programState->getIntAttribute ("index", -1) == program)
+                    return programState->getChildByName ("curveState");
+        return nullptr;
+    }
+}
+
+// Nothing may throw across the C boundary, so the only exception the engine can meet (running out of memory) ends up
+// as a NULL curve
+
+mt_curve* mt_curve_load(const void* state, size_t sizeInBytes, int program) {
+    try {
+        const auto xml = getXmlFromBinary (state, sizeInBytes);
+        const auto* curveState = xml != nullptr ? findCurveState (*xml, program) : nullptr;
+        if (curveState == nullptr)
+            return nullptr;
+
+        auto curve = std::make_unique<mt_curve>();
+        if (!curve->curve.fromXml (*curveState))
+            return nullptr;
+        if (program != MT_CURVE_LIVE) {
+            // The plugin bakes the same curve to the same table whether it adopts the saved tables or not, so baking
+            // again here gives its exact results without reading them
+            curve->program = std::make_unique<aas::ProgramCurve>();
+            curve->program->bake (curve->curve);
+        }
+        curve->bakeControllerTable();
+        return curve.release();
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+mt_curve* mt_curve_bake(const mt_curve* source, float maxError) {
+    if (source == nullptr || !(maxError > 0.0f))
+        return nullptr;
+    try {
+        auto curve = std::make_unique<mt_curve>();
+        curve->curve = source->curve;
+        curve->table = std::make_unique<aas::AdaptiveCurveTable>();
+        curve->table->bake (curve->curve.minX, curve->curve.maxX, maxError, [&source](float input) { return source->curve.compute (input); });
+        curve->bakeControllerTable();
+        return curve.release();
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void mt_curve_evaluate_float(const mt_curve* curve, const float* input, float* output, size_t count) {
+    if (curve == nullptr)
+        return;
+    for (size_t i = 0; i < count; i++)
+        output[i] = curve->compute (input[i]);
+}
+
+void mt_curve_evaluate_uint8(const mt_curve* curve, const uint8_t* input, uint8_t* output, size_t count) {
+    if (curve == nullptr)
+        return;
+    for (size_t i = 0; i < count; i++)
+        output[i] = curve->controllerTable[jmin<size_t> (input[i], 127)];
+}
+
+void mt_curve_evaluate_uint16(const mt_curve* curve, const uint16_t* input, uint16_t* output, size_t count) {
+    if (curve == nullptr)
+        return;
+    // As transformMidi() maps pitch bend onto the curve's range and back
+    const float range = curve->curve.maxY - curve->curve.minY;
+    for (size_t i = 0; i < count; i++) {
+        const float inputValue = (static_cast<float> (jmin<int> (input[i], (1 << 14) - 1)) / static_cast<float> (1 << 14)) * range;
+        const float outputValue = (curve->compute (inputValue) * (1 << 14)) / range;
+        output[i] = static_cast<uint16_t> (jlimit (0, (1 << 14) - 1, static_cast<int> (outputValue)));
+    }
+}
+
+size_t mt_curve_get_memory_bytes(const mt_curve* curve) {
+    if (curve == nullptr)
+        return 0;
+    size_t bytes = sizeof (mt_curve) + curve->curve.nodes.capacity() * sizeof (aas::CurveFunction<float>::Node)
+                   + (curve->table != nullptr ? curve->table->getMemoryBytes() : 0);
+    if (curve->program != nullptr)
+        bytes += sizeof (aas::ProgramCurve) + curve->program->getCurve().nodes.capacity() * sizeof (aas::CurveFunction<float>::Node)
+                 + curve->program->getTable().getSamples().capacity() * sizeof (float);
+    return bytes;
+}
+
+float mt_curve_get_error(const mt_curve* curve) {
+    if (curve != nullptr && curve->program != nullptr)
+        return curve->program->getTable().getAchievedError();
+    return curve != nullptr && curve->table != nullptr ? curve->table->getAchievedError() : 0.0f;
+}
+
+void mt_curve_free(mt_curve* curve) {
+    delete curve;
+}
@@ -0,0 +1,90 @@
+/*
+    MIDI-Transformer curve engine: the plugin's response curves, for software that embeds them without JUCE's GUI
+    modules. Plain C, so it can be called from any language with a C FFI.
+
+    Load a curve from a state blob saved by the plugin (the same bytes a host stores, or the state in a capture log),
+    then evaluate batches of values with it. Every function works on buffers the caller owns and never keeps a pointer
+    to them. A curve never changes once created, so any number of threads may evaluate the same curve at once without
+    locking. Only mt_curve_free() must not overlap with anything else using that curve.
+*/
+
+#ifndef MIDI_TRANSFORMER_CURVE_ENGINE_H
+#define MIDI_TRANSFORMER_CURVE_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined (_WIN32)
+ #if defined (MT_CURVE_ENGINE_BUILD)
+  #define MT_CURVE_API __declspec (dllexport)
+ #else
+  #define MT_CURVE_API __declspec (dllimport)
+ #endif
+#else
+ #define MT_CURVE_API __attribute__ ((visibility ("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A response curve. Opaque; create with mt_curve_load() or mt_curve_bake(), destroy with mt_curve_free(). */
+typedef struct mt_curve mt_curve;
+
+/** Pass as the program to load the curve that was live when the state was saved, rather than a stored program */
+#define MT_CURVE_LIVE (-1)
+
+/**
+    Read a curve from a state blob saved by the plugin. program is MT_CURVE_LIVE, or the index (0-127) of one of the
+    stored programs. Returns NULL if the blob isn't a plugin state or has no such curve.
+
+    The live curve is evaluated exactly, as the plugin evaluates it: slowly (up to a few microseconds a value for
+    curved segments) but identical to the plugin. Bake it for use in a realtime thread. A stored program is baked as
+    the plugin bakes its programs, exact at whole-number inputs and through the plugin's table between them (see
+    mt_curve_get_error() for how close that table comes), so it too maps every input exactly as the plugin plays that
+    program.
+*/
+MT_CURVE_API mt_curve* mt_curve_load (const void* state, size_t size_in_bytes, int program);
+
+/**
+    Bake a curve into a table that stays within max_error of it (in output units, 0-127), as the plugin does for its
+    programs. Every lookup then costs the same small, constant time. The source curve is left as it was, and may be
+    freed. Returns NULL if max_error is not positive or memory runs out.
+*/
+MT_CURVE_API mt_curve* mt_curve_bake (const mt_curve* curve, float max_error);
+
+/**
+    Map count inputs, in the curve's 0-127 range, to outputs in the same range. Inputs outside the range are clamped
+    and NaNs map to the start of the curve. output may be the same buffer as input.
+*/
+MT_CURVE_API void mt_curve_evaluate_float (const mt_curve* curve, const float* input, float* output, size_t count);
+
+/**
+    Map 7-bit values as the plugin maps one controller to another: the output is truncated to a whole number.
+    Inputs above 127 are clamped. output may be the same buffer as input.
+*/
+MT_CURVE_API void mt_curve_evaluate_uint8 (const mt_curve* curve, const uint8_t* input, uint8_t* output, size_t count);
+
+/**
+    Map 14-bit values (0-16383) as the plugin maps pitch bend to pitch bend. Inputs above 16383 are clamped. output
+    may be the same buffer as input.
+*/
+MT_CURVE_API void mt_curve_evaluate_uint16 (const mt_curve* curve, const uint16_t* input, uint16_t* output, size_t count);
+
+/** Bytes the curve holds, including its table if it was baked */
+MT_CURVE_API size_t mt_curve_get_memory_bytes (const mt_curve* curve);
+
+/**
+    For a baked curve or a stored program, the largest difference from the exact curve found halfway between the
+    table's samples; 0 for an exact curve.
+*/
+MT_CURVE_API float mt_curve_get_error (const mt_curve* curve);
+
+/** Destroy a curve. NULL is ignored. */
+MT_CURVE_API void mt_curve_free (mt_curve* curve);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * A curve baked into a piecewise-linear table whose resolution follows the curve, so that interpolating in it
+     * stays within a chosen error of the curve itself.
+     *
+     * The input range is split into numCells equal cells, and each cell is sampled evenly at its own resolution: 1,
+     * 2, 4... up to maxSegmentsPerCell segments, doubled until the curve halfway between every pair of neighbouring
+     * samples is within half the error bound of the straight line between them. (Along a smooth curve the error is
+     * largest halfway; a corner can put it anywhere in the segment, but no more than twice as high.) A straight
+     * stretch costs two samples; a steep bend gets as many as it needs. At the finest resolution the samples fall on
+     * every 14-bit input.
+     *
+     * A lookup reads one index entry and two samples, so it costs the same wherever the input falls and however
+     * fine the table is.
+     *
+     * The editor's bezier curves are found by searching 101 points along each segment, so they rise in tiny steps
+     * that no number of samples can follow. Such a cell refines all the way to maxSegmentsPerCell and still misses
+     * the bound: bake() then returns false, and getAchievedError() reports what was left.
+     */
+    class AdaptiveCurveTable {
+    public:
+        static constexpr int numCells = 16;
+        static constexpr int maxSegmentsPerCell = 1024;
+        /** In output units: a 50th of a 7-bit step, or about two 14-bit pitch bend steps over a 0-127 range */
+        static constexpr float defaultMaxError = 0.02f;
+
+        using SegmentCounts = std::array<uint16, numCells>;
+
+        AdaptiveCurveTable() {
+            SegmentCounts counts;
+            counts.fill (1);
+            adopt (0.0f, 127.0f, counts, std::vector<float> (numCells + 1, 0.0f), 0.0f, 0.0f);
+        }
+
+        /**
+         * Sample curve(x), for x in minX..maxX, until the table is within maxError of it (see the class comment).
+         * \return false if some cell missed the bound even at the finest resolution
+         */
+        template <typename Function>
+        bool bake(float newMinX, float newMaxX, float newMaxError, Function&& curve) {
+            minX = newMinX;
+            cellsPerUnit = static_cast<float> (numCells) / (newMaxX - newMinX);
+            maxError = newMaxError;
+            achievedError = 0.0f;
+            samples.clear();
+
+            const double cellWidth = static_cast<double> (newMaxX - newMinX) / numCells;
+            auto sampleAt = [&](double x) { return static_cast<float> (curve (static_cast<float> (x))); };
+            samples.push_back (sampleAt (newMinX));
+
+            std::vector<float> level, midpoints;
+            for (int c = 0; c < numCells; c++) {
+                const double start = newMinX + cellWidth * c;
+                level.assign ({samples.back(), sampleAt (start + cellWidth)});
+                int numSegments = 1;
+                for (;;) {
+                    const double segmentWidth = cellWidth / numSegments;
+                    float error = 0.0f;
+                    midpoints.resize ((size_t) numSegments);
+                    for (int i = 0; i < numSegments; i++) {
+                        midpoints[(size_t) i] = sampleAt (start + segmentWidth * (i + 0.5));
+                        error = jmax (error, std::abs (midpoints[(size_t) i] - 0.5f * (level[(size_t) i] + level[(size_t) i + 1])));
+                    }
+
+                    if (error <= 0.5f * maxError || numSegments == maxSegmentsPerCell) {
+                        achievedError = jmax (achievedError, error);
+                        break;
+                    }
+
+                    // The midpoints just tested become the samples of the next, twice as fine, level
+                    std::vector<float> finer ((size_t) numSegments * 2 + 1);
+                    for (int i = 0; i < numSegments; i++) {
+                        finer[(size_t) i * 2] = level[(size_t) i];
+                        finer[(size_t) i * 2 + 1] = midpoints[(size_t) i];
+                    }
+                    finer.back() = level.back();
+                    level = std::move (finer);
+                    numSegments *= 2;
+                }
+
+                cells[(size_t) c] = {static_cast<uint32> (samples.size() - 1), static_cast<uint32> (numSegments)};
+                samples.insert (samples.end(), level.begin() + 1, level.end());
+            }
+            return meetsMaxError();
+        }
+
+        /**
+         * Take a table saved earlier (see BakedTables.h) instead of baking it again.
+         * \return false, with nothing changed, if the counts and samples don't describe a table.
+         */
+        bool adopt(float newMinX, float newMaxX, const SegmentCounts& counts, std::vector<float> newSamples, float newMaxError,
+                   float newAchievedError) {
+            size_t numSegments = 0;
+            for (const auto count : counts) {
+                if (count == 0 || count > maxSegmentsPerCell || !isPowerOfTwo (count))
+                    return false;
+                numSegments += count;
+            }
+            if (newSamples.size() != numSegments + 1 || newMaxX <= newMinX)
+                return false;
+
+            minX = newMinX;
+            cellsPerUnit = static_cast<float> (numCells) / (newMaxX - newMinX);
+            maxError = newMaxError;
+            achievedError = newAchievedError;
+            samples = std::move (newSamples);
+            uint32 firstSample = 0;
+            for (size_t c = 0; c < cells.size(); c++) {
+                cells[c] = {firstSample, counts[c]};
+                firstSample += counts[c];
+            }
+            return true;
+        }
+
+        /** Linear interpolation between the two samples either side of the input. Inputs are clamped to the range. */
+        float compute(float input) const noexcept {
+            const float position = std::isfinite (input) ? jlimit (0.0f, static_cast<float> (numCells), (input - minX) * cellsPerUnit) : 0.0f;
+            const int cellIndex = jmin (static_cast<int> (position), numCells - 1);
+            const auto& cell = cells[(size_t) cellIndex];
+            const float local = (position - static_cast<float> (cellIndex)) * static_cast<float> (cell.numSegments);
+            const int segment = jmin (static_cast<int> (local), static_cast<int> (cell.numSegments) - 1);
+            const float fraction = local - static_cast<float> (segment);
+            const float* pair = samples.data() + cell.firstSample + segment;
+            return pair[0] + fraction * (pair[1] - pair[0]);
+        }
+
+        SegmentCounts getSegmentCounts() const noexcept {
+            SegmentCounts counts;
+            for (size_t c = 0; c < cells.size(); c++)
+                counts[c] = static_cast<uint16> (cells[c].numSegments);
+            return counts;
+        }
+
+        const std::vector<float>& getSamples() const noexcept { return samples; }
+
+        /** The largest difference from the curve halfway between samples, where linear interpolation strays furthest */
+        float getAchievedError() const noexcept { return achievedError; }
+        /** The bound the table was baked to */
+        float getMaxError() const noexcept { return maxError; }
+        /** Whether every cell passed the halfway test above, so that the table stays within the bound everywhere */
+        bool meetsMaxError() const noexcept { return achievedError <= 0.5f * maxError; }
+
+        /** Bytes held by the index and the samples */
+        size_t getMemoryBytes() const noexcept { return sizeof (cells) + samples.size() * sizeof (float); }
+
+    private:
+        struct Cell {
+            uint32 firstSample;
+            uint32 numSegments;
+        };
+
+        float minX = 0.0f;
+        float cellsPerUnit = 1.0f;
+        float maxError = 0.0f;
+        float achievedError = 0.0f;
+        std::array<Cell, numCells> cells{};
+        std::vector<float> samples;
+    };
+}
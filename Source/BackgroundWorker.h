@@ -0,0 +1,178 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * A fixed pool of threads shared by every plugin instance in the process, for work that must stay off both the
+     * audio and the message thread (baking, draining queues, writing captures).
+     *
+     * Each owner submits jobs through its own Client, keyed by what the job does. A job posted while another with the
+     * same client and key is still queued replaces it, so a burst of edits runs once, with the latest state. Jobs
+     * with the same client and key never run at the same time, so a job may assume it is the only consumer of
+     * whatever it drains. Otherwise the highest priority job that has waited longest runs first.
+     *
+     * The pool is created with the first Client and destroyed with the last, and its thread count does not depend on
+     * how many instances are loaded.
+     */
+    class BackgroundWorker {
+    public:
+        enum class Priority {
+            High = 0, ///< Affects what is heard, e.g. baking an edited curve
+            Normal,   ///< Must keep up, e.g. writing a capture to disk
+            Low       ///< Only affects what is shown
+        };
+
+        static constexpr int numThreads = 2;
+
+        class Client {
+        public:
+            Client() = default;
+            ~Client() { cancelAll(); }
+
+            /** Queue a job, replacing any queued job with the same key. Any thread but the audio thread. */
+            void post(int key, Priority priority, std::function<void()> job) {
+                worker->post (this, key, priority, std::move (job));
+            }
+
+            /** Drop every queued job and wait for any that are running to finish. */
+            void cancelAll() {
+                worker->cancel (this);
+            }
+
+        private:
+            SharedResourcePointer<BackgroundWorker> worker;
+
+            JUCE_DECLARE_NON_COPYABLE (Client)
+        };
+
+        BackgroundWorker() {
+            for (int i = 0; i < numThreads; i++) {
+                threads.add (new WorkerThread (*this, i));
+                // Just below normal priority; JUCE 7.0.3 replaced the 0-10 priorities with Thread::Priority
+#if JUCE_VERSION >= 0x070003
+                threads.getLast()->startThread (Thread::Priority::low);
+#else
+                threads.getLast()->startThread (4);
+#endif
+            }
+        }
+
+        ~BackgroundWorker() {
+            for (auto* thread : threads)
+                thread->signalThreadShouldExit();
+            for (auto* thread : threads)
+                thread->notify();
+            for (auto* thread : threads)
+                thread->stopThread (2000);
+        }
+
+    private:
+        struct Job {
+            Client* client;
+            int key;
+            Priority priority;
+            uint64 order;
+            std::function<void()> function;
+        };
+
+        class WorkerThread : public Thread {
+        public:
+            WorkerThread(BackgroundWorker& workerIn, int index) :
+                Thread ("Background worker " + String (index + 1)),
+                worker (workerIn) { }
+
+            void run() override {
+                while (!threadShouldExit())
+                    if (!worker.runNextJob())
+                        wait (-1);
+            }
+
+        private:
+            BackgroundWorker& worker;
+        };
+
+        void post(Client* client, int key, Priority priority, std::function<void()> function) {
+            {
+                const ScopedLock sl (lock);
+                auto queued = std::find_if (jobs.begin(), jobs.end(), [&](const Job& job) { return job.client == client && job.key == key; });
+                if (queued != jobs.end()) {
+                    queued->function = std::move (function);
+                    queued->priority = jmin (queued->priority, priority);
+                    return;
+                }
+                jobs.push_back ({client, key, priority, nextOrder++, std::move (function)});
+            }
+            for (auto* thread : threads)
+                thread->notify();
+        }
+
+        void cancel(Client* client) {
+            auto isRunning = [&] { return std::any_of (running.begin(), running.end(), [&](const Job& job) { return job.client == client; }); };
+
+            // Sleep until a job finishes, rather than spin, and look again each time one does
+            WaitableEvent jobFinished;
+            {
+                const ScopedLock sl (lock);
+                jobs.erase (std::remove_if (jobs.begin(), jobs.end(), [&](const Job& job) { return job.client == client; }), jobs.end());
+                if (!isRunning())
+                    return;
+                cancelWaiters.push_back (&jobFinished);
+            }
+            for (;;) {
+                jobFinished.wait (-1);
+                const ScopedLock sl (lock);
+                if (!isRunning()) {
+                    cancelWaiters.erase (std::find (cancelWaiters.begin(), cancelWaiters.end(), &jobFinished));
+                    return;
+                }
+            }
+        }
+
+        /** \return false if there was nothing that could run */
+        bool runNextJob() {
+            std::function<void()> function;
+            uint64 order;
+            {
+                const ScopedLock sl (lock);
+                auto next = jobs.end();
+                for (auto job = jobs.begin(); job != jobs.end(); ++job) {
+                    const bool isRunning = std::any_of (running.begin(), running.end(), [&](const Job& other)
+                    {
+                        return other.client == job->client && other.key == job->key;
+                    });
+                    if (!isRunning && (next == jobs.end() || std::tie (job->priority, job->order) < std::tie (next->priority, next->order)))
+                        next = job;
+                }
+                if (next == jobs.end())
+                    return false;
+
+                function = std::move (next->function);
+                order = next->order;
+                running.push_back ({next->client, next->key, next->priority, next->order, {}});
+                jobs.erase (next);
+            }
+
+            function();
+
+            const ScopedLock sl (lock);
+            running.erase (std::find_if (running.begin(), running.end(), [&](const Job& job) { return job.order == order; }));
+            for (auto* waiter : cancelWaiters)
+                waiter->signal();
+            // A job with the same key may have been held back while this one ran
+            for (auto* thread : threads)
+                thread->notify();
+            return true;
+        }
+
+        CriticalSection lock;
+        std::vector<Job> jobs;
+        std::vector<Job> running;
+        // Threads inside cancel(), waiting for a running job to finish
+        std::vector<WaitableEvent*> cancelWaiters;
+        uint64 nextOrder = 0;
+        OwnedArray<WorkerThread> threads;
+
+        JUCE_DECLARE_NON_COPYABLE (BackgroundWorker)
+    };
+}
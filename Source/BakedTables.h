@@ -0,0 +1,114 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * Baked tables saved next to the curves they were baked from, so that restoring a session can adopt them instead
+     * of evaluating every curve again.
+     *
+     * Each set of tables is saved with a hash of the curves and zones it was baked from, as they appear in the saved
+     * XML, and of the table format. A restore only adopts the tables if the hash still matches, so a state edited by
+     * hand, or saved by a build that bakes differently, is simply baked again. Tables are saved in the machine's byte
+     * order, which is little-endian on every platform the plugin builds for.
+     */
+    namespace BakedTables
+    {
+        /** Bump whenever a change to the code alters what a bake produces */
+        static constexpr int format = 4;
+
+        /** A hash of the curveState, upperCurveState and zones children of a state or program tree, and the format */
+        inline String hash(const ValueTree& source) {
+            uint64 value = 14695981039346656037ull;
+            auto add = [&value](const void* data, size_t size)
+            {
+                for (size_t i = 0; i < size; i++)
+                    value = (value ^ static_cast<const uint8*> (data)[i]) * 1099511628211ull;
+            };
+
+            add (&format, sizeof (format));
+            for (const auto* name : {"curveState", "upperCurveState", "zones"}) {
+                const auto child = source.getChildWithName (name);
+                const auto xml = child.isValid() ? child.createXml() : nullptr;
+                const auto text = xml != nullptr ? xml->toString (XmlElement::TextFormat().singleLine().withoutHeader()) : String();
+                add (text.toRawUTF8(), text.getNumBytesAsUTF8() + 1);
+            }
+            return String::toHexString (static_cast<int64> (value));
+        }
+
+        /**
+         * Every value in the tables is a 7-bit MIDI value, give or take rounding, and every whole-number table holds
+         * 7-bit values (uint8) or at most 14-bit ones (uint16), so anything else means damage. AdaptiveCurveTable::adopt()
+         * checks its segment counts more closely.
+         */
+        template <size_t size>
+        bool isUsable(const std::array<uint8, size>& table) {
+            return std::all_of (table.begin(), table.end(), [](uint8 value) { return value <= 127; });
+        }
+
+        template <size_t size>
+        bool isUsable(const std::array<uint16, size>& table) {
+            return std::all_of (table.begin(), table.end(), [](uint16 value) { return value <= 16383; });
+        }
+
+        template <size_t size>
+        bool isUsable(const std::array<float, size>& table) {
+            return std::all_of (table.begin(), table.end(), [](float value) { return std::isfinite (value) && value >= -1.0f && value <= 128.0f; });
+        }
+
+        template <typename Row, size_t size>
+        bool isUsable(const std::array<Row, size>& table) {
+            return std::all_of (table.begin(), table.end(), [](const Row& row) { return isUsable (row); });
+        }
+
+        inline bool isUsable(const std::vector<float>& table) {
+            return std::all_of (table.begin(), table.end(), [](float value) { return std::isfinite (value) && value >= -1.0f && value <= 128.0f; });
+        }
+
+        template <typename Table>
+        void write(XmlElement& element, const Identifier& name, const Table& table) {
+            element.setAttribute (name, MemoryBlock (table.data(), sizeof (Table)).toBase64Encoding());
+        }
+
+        /** \return false, leaving the table untouched, if the attribute is missing, the wrong size or damaged */
+        template <typename Table>
+        bool read(const XmlElement& element, const Identifier& name, Table& table) {
+            MemoryBlock block;
+            if (!block.fromBase64Encoding (element.getStringAttribute (name)) || block.getSize() != sizeof (Table))
+                return false;
+            Table decoded;
+            std::memcpy (decoded.data(), block.getData(), sizeof (Table));
+            if (!isUsable (decoded))
+                return false;
+            table = decoded;
+            return true;
+        }
+
+        /** Tables whose size depends on the curve, such as an AdaptiveCurveTable's samples */
+        inline void write(XmlElement& element, const Identifier& name, const std::vector<float>& table) {
+            element.setAttribute (name, MemoryBlock (table.data(), table.size() * sizeof (float)).toBase64Encoding());
+        }
+
+        inline bool read(const XmlElement& element, const Identifier& name, std::vector<float>& table) {
+            MemoryBlock block;
+            if (!block.fromBase64Encoding (element.getStringAttribute (name)) || block.isEmpty() || block.getSize() % sizeof (float) != 0)
+                return false;
+            std::vector<float> decoded (block.getSize() / sizeof (float));
+            std::memcpy (decoded.data(), block.getData(), block.getSize());
+            if (!isUsable (decoded))
+                return false;
+            table = std::move (decoded);
+            return true;
+        }
+
+        /** \return the entry with the given tag name and hash, or nullptr */
+        inline const XmlElement* find(const XmlElement* tables, const String& tagName, const String& expectedHash) {
+            if (tables == nullptr || tables->getIntAttribute ("format") != format)
+                return nullptr;
+            for (auto* entry = tables->getChildByName (tagName); entry != nullptr; entry = entry->getNextElementWithTagName (tagName))
+                if (entry->getStringAttribute ("hash") == expectedHash)
+                    return entry;
+            return nullptr;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <JuceHeader.h>
+#include "CurveEditor.h"
+
+#if defined (__AVX512VBMI__) || defined (__SSSE3__) || defined (__AVX__)
+ #include <immintrin.h>
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+#endif
+
+namespace aas
+{
+    /** A 7-bit transform baked into a table: the output for input i is table[i]. */
+    using ByteTable = std::array<uint8, 128>;
+
+    /** The curve as the live transform applies it to a controller value: truncated, then clamped to 0-127. */
+    inline ByteTable bakeControllerTable(CurveEditorModel<float>& model) {
+        ByteTable table;
+        for (int i = 0; i < 128; i++)
+            table[(size_t) i] = static_cast<uint8> (jlimit (0, 127, static_cast<int> (model.compute (static_cast<float> (i)))));
+        return table;
+    }
+
+    /** The curve as the live transform applies it to a note-on velocity (see MidiMessage::setVelocity). */
+    inline ByteTable bakeVelocityTable(CurveEditorModel<float>& model) {
+        ByteTable table;
+        for (int i = 0; i < 128; i++)
+            table[(size_t) i] = MidiMessage::floatValueToMidiByte ((model.compute (static_cast<float> (i)) - model.minY) / (model.maxY - model.minY));
+        return table;
+    }
+
+    /** Which of the remapBytes() kernels this build uses */
+    inline const char* getRemapKernelName() noexcept {
+       #if defined (__AVX512VBMI__)
+        return "AVX-512 VBMI";
+       #elif defined (__SSSE3__) || defined (__AVX__)
+        return "SSSE3";
+       #elif defined (__aarch64__) || defined (_M_ARM64)
+        return "NEON";
+       #else
+        return "scalar";
+       #endif
+    }
+
+    /**
+     * Replace every byte with its entry in the table, in place. Only the low 7 bits of each byte are used.
+     *
+     * The whole table fits in vector registers, so each vector of bytes is looked up at once: with one VPERMI2B over
+     * two 64-byte halves on AVX-512 VBMI, with eight PSHUFB lookups (one per 16-byte slice) on SSSE3, and with a pair
+     * of 64-byte TBL/TBX lookups on AArch64 NEON. The kernel is picked when compiling, from the target's instruction
+     * set. Other targets, and the tail of every batch, use a plain loop.
+     */
+    inline void remapBytes(const ByteTable& table, uint8* data, size_t numBytes) noexcept {
+        size_t i = 0;
+
+       #if defined (__AVX512VBMI__)
+        const __m512i low = _mm512_loadu_si512 (table.data());
+        const __m512i high = _mm512_loadu_si512 (table.data() + 64);
+        for (; i + 64 <= numBytes; i += 64) {
+            // Bit 6 of each index picks the half, bits 0-5 the entry; bit 7 is ignored
+            const __m512i indices = _mm512_loadu_si512 (data + i);
+            _mm512_storeu_si512 (data + i, _mm512_permutex2var_epi8 (low, indices, high));
+        }
+       #elif defined (__SSSE3__) || defined (__AVX__)
+        __m128i slices[8];
+        for (int k = 0; k < 8; k++)
+            slices[k] = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (table.data() + 16 * k));
+        const __m128i sevenBits = _mm_set1_epi8 (0x7f);
+        const __m128i bias = _mm_set1_epi8 (0x70);
+        for (; i + 16 <= numBytes; i += 16) {
+            const __m128i indices = _mm_and_si128 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (data + i)), sevenBits);
+            __m128i result = _mm_setzero_si128();
+            for (int k = 0; k < 8; k++) {
+                // Indices in slice k land on 0x70-0x7f, whose low nibble picks the entry. All others saturate to 0x80
+                // or above, for which PSHUFB returns 0.
+                const __m128i local = _mm_adds_epu8 (_mm_sub_epi8 (indices, _mm_set1_epi8 (static_cast<char> (16 * k))), bias);
+                result = _mm_or_si128 (result, _mm_shuffle_epi8 (slices[k], local));
+            }
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (data + i), result);
+        }
+       #elif defined (__aarch64__) || defined (_M_ARM64)
+        const uint8* entries = table.data();
+        const uint8x16x4_t low{{vld1q_u8 (entries), vld1q_u8 (entries + 16), vld1q_u8 (entries + 32), vld1q_u8 (entries + 48)}};
+        const uint8x16x4_t high{{vld1q_u8 (entries + 64), vld1q_u8 (entries + 80), vld1q_u8 (entries + 96), vld1q_u8 (entries + 112)}};
+        const uint8x16_t sevenBits = vdupq_n_u8 (0x7f);
+        const uint8x16_t halfway = vdupq_n_u8 (64);
+        for (; i + 16 <= numBytes; i += 16) {
+            const uint8x16_t indices = vandq_u8 (vld1q_u8 (data + i), sevenBits);
+            // TBL gives 0 for indices past the low half; TBX then fills those from the high half and leaves the rest
+            vst1q_u8 (data + i, vqtbx4q_u8 (vqtbl4q_u8 (low, indices), high, vsubq_u8 (indices, halfway)));
+        }
+       #endif
+
+        for (; i < numBytes; i++)
+            data[i] = table[data[i] & 0x7f];
+    }
+
+    /**
+     * Remaps one data byte of many events with the same table, in three passes over packed arrays: the bytes are
+     * gathered from the events, remapped together by remapBytes(), and scattered back. Meant for offline batches,
+     * where dispatching on every event would cost more than the lookup itself.
+     *
+     * The gathered buffers must not change or be destroyed until apply() has run.
+     */
+    class ByteRemapBatch {
+    public:
+        void clear() noexcept {
+            targets.clear();
+            values.clear();
+        }
+
+        size_t size() const noexcept { return values.size(); }
+
+        /** Add the value of every event for the given controller, and renumber those events to newController. */
+        void gatherControllers(MidiBuffer& buffer, int controller, int newController) {
+            forEachEvent (buffer, [&](uint8* bytes, int numBytes)
+            {
+                if (numBytes == 3 && (bytes[0] & 0xf0) == 0xb0 && bytes[1] == controller) {
+                    bytes[1] = static_cast<uint8> (newController);
+                    add (bytes[2]);
+                }
+            });
+        }
+
+        /** Add the velocity of every note on. Note ons with a velocity of 0 are note offs, and are left alone. */
+        void gatherVelocities(MidiBuffer& buffer) {
+            forEachEvent (buffer, [&](uint8* bytes, int numBytes)
+            {
+                if (numBytes == 3 && (bytes[0] & 0xf0) == 0x90 && bytes[2] != 0)
+                    add (bytes[2]);
+            });
+        }
+
+        /** Remap everything gathered so far and write it back. */
+        void apply(const ByteTable& table) noexcept {
+            remapBytes (table, values.data(), values.size());
+            for (size_t i = 0; i < values.size(); i++)
+                *targets[i] = values[i];
+        }
+
+    private:
+        void add(uint8& dataByte) {
+            targets.push_back (&dataByte);
+            values.push_back (static_cast<uint8> (dataByte & 0x7f));
+        }
+
+        /** The buffer is ours to change, so its events are edited in place rather than copied out and back in. */
+        template <typename Function>
+        static void forEachEvent(MidiBuffer& buffer, Function&& function) {
+            for (const auto metadata : buffer)
+                function (const_cast<uint8*> (metadata.data), metadata.numBytes);
+        }
+
+        std::vector<uint8*> targets;
+        std::vector<uint8> values;
+    };
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * Renders a stream of transformed values as a smoothed, sample-accurate control signal, for driving CV interfaces
+     * or modulating audio at audio rate.
+     *
+     * Each new value starts a short linear ramp at the exact sample position of the event that produced it. Ramps are
+     * filled with vector operations against a precomputed 1, 2, 3, ... table, so a block in which nothing changes costs
+     * a single fill per channel.
+     *
+     * The signal can be delayed by a number of samples given with each block, to keep it in step with MIDI that is
+     * delayed as much on its way out. Values wait for their time in a queue allocated by prepare().
+     */
+    class ControlSignalRenderer {
+    public:
+        struct Point {
+            int samplePosition;
+            float value; ///< Normalised to 0..1
+        };
+
+        void prepare(double sampleRate, int maximumBlockSize) {
+            rampLengthSamples = jmax (1, roundToInt (sampleRate * rampSeconds));
+            rampFloat.resize ((size_t) jmax (1, maximumBlockSize));
+            rampDouble.resize (rampFloat.size());
+            for (size_t i = 0; i < rampFloat.size(); i++) {
+                rampFloat[i] = static_cast<float> (i + 1);
+                rampDouble[i] = static_cast<double> (i + 1);
+            }
+            pending.resize ((size_t) maxPendingPoints);
+            discardPending();
+            time = 0;
+        }
+
+        /** Forget the values still waiting out their delay, as when the signal is switched off */
+        void discardPending() noexcept {
+            pendingHead = pendingCount = 0;
+        }
+
+        /**
+         * Overwrite every channel of the buffer with the signal for this block.
+         *
+         * \param points        the values that arrived during the block, in sample order
+         * \param delaySamples  how far to delay them
+         * \return how many values had no room in the queue. Each one replaces the newest waiting value.
+         */
+        template <typename Element>
+        int render(AudioBuffer<Element>& audio, const Point* points, int numPoints, int delaySamples) noexcept {
+            int dropped = 0;
+            for (int i = 0; i < numPoints; i++) {
+                if (pendingCount < pending.size())
+                    pendingCount++;
+                else
+                    dropped++;
+                pending[(pendingHead + pendingCount - 1) % pending.size()] = {time + points[i].samplePosition + delaySamples, points[i].value};
+            }
+
+            const int numSamples = audio.getNumSamples();
+            auto* dest = audio.getNumChannels() > 0 ? audio.getWritePointer (0) : nullptr;
+            int position = 0;
+            while (pendingCount > 0 && pending[pendingHead].due < time + numSamples) {
+                const auto& point = pending[pendingHead];
+                const int eventPosition = jlimit (position, numSamples, static_cast<int> (jmax ((int64) 0, point.due - time)));
+                if (dest != nullptr)
+                    fill (dest + position, eventPosition - position);
+                position = eventPosition;
+
+                target = point.value;
+                rampRemaining = rampLengthSamples;
+                rampStep = (target - current) / static_cast<double> (rampLengthSamples);
+                pendingHead = (pendingHead + 1) % pending.size();
+                pendingCount--;
+            }
+            if (dest != nullptr) {
+                fill (dest + position, numSamples - position);
+                for (int channel = 1; channel < audio.getNumChannels(); channel++)
+                    FloatVectorOperations::copy (audio.getWritePointer (channel), dest, numSamples);
+            }
+            time += numSamples;
+            return dropped;
+        }
+
+    private:
+        template <typename Element>
+        void fill(Element* dest, int numSamples) noexcept {
+            const auto& ramp = getRamp<Element>();
+            while (rampRemaining > 0 && numSamples > 0) {
+                const int n = jmin (numSamples, rampRemaining, static_cast<int> (ramp.size()));
+                FloatVectorOperations::copyWithMultiply (dest, ramp.data(), static_cast<Element> (rampStep), n);
+                FloatVectorOperations::add (dest, static_cast<Element> (current), n);
+
+                rampRemaining -= n;
+                current = rampRemaining > 0 ? current + rampStep * n : target;
+                dest += n;
+                numSamples -= n;
+            }
+
+            if (numSamples > 0)
+                FloatVectorOperations::fill (dest, static_cast<Element> (current), numSamples);
+        }
+
+        template <typename Element>
+        const std::vector<Element>& getRamp() const noexcept;
+
+        struct PendingPoint {
+            int64 due;
+            float value;
+        };
+
+        static constexpr double rampSeconds = 0.005;
+        /** Room for a few hundred values per block across any delay the decimator reports */
+        static constexpr int maxPendingPoints = 4096;
+        int rampLengthSamples = 1;
+        int rampRemaining = 0;
+        double current = 0.0;
+        double target = 0.0;
+        double rampStep = 0.0;
+        std::vector<float> rampFloat = std::vector<float> (1, 1.0f);
+        std::vector<double> rampDouble = std::vector<double> (1, 1.0);
+        std::vector<PendingPoint> pending = std::vector<PendingPoint> (1);
+        size_t pendingHead = 0, pendingCount = 0;
+        // Running sample count at the start of the current block
+        int64 time = 0;
+    };
+
+    template <>
+    inline const std::vector<float>& ControlSignalRenderer::getRamp<float>() const noexcept { return rampFloat; }
+
+    template <>
+    inline const std::vector<double>& ControlSignalRenderer::getRamp<double>() const noexcept { return rampDouble; }
+}
@@ -1,5 +1,9 @@
 #pragma once
 #include <JuceHeader.h>
+#include "BackgroundWorker.h"
+#include "CurveFunction.h"
+#include "FrameClock.h"
+#include "PerformanceStats.h"
 
 namespace aas
 {
@@ -8,13 +12,8 @@ namespace aas
         using NumericType = T;
         using PointType = juce::Point<T>;
 
-        enum class CurveType {
-            Linear = 0,
-            Quadratic,
-            Cubic
-        };
-
-        static constexpr int CurveTypeCount = 3;
+        using CurveType = aas::CurveType;
+        static constexpr int CurveTypeCount = aas::CurveTypeCount;
 
         struct Handle;
 
@@ -86,21 +85,61 @@ namespace aas
             nodes.emplace_back (std::make_shared<Node> (PointType{maxX, maxY}));
         }
 
-        void fromValueTree(const ValueTree& tree) {
-            if (tree.getNumChildren()) {
-                nodes.clear();
-                for (int i = 0; i < tree.getNumChildren(); i++) {
-                    auto child = tree.getChild(i);
-                    auto anchor = child.getChildWithName("anchor");
-                    auto control1 = child.getChildWithName("control1");
-                    auto control2 = child.getChildWithName("control2");
-                    auto node = std::make_shared<Node>(PointType{ anchor.getProperty("x"), anchor.getProperty("y") });
-                    node->curveType = static_cast<CurveType> (static_cast<int> (child.getProperty("curveType")));
-                    node->setControlPt1(PointType{ control1.getProperty("x"), control1.getProperty("y") });
-                    node->setControlPt2(PointType{ control2.getProperty("x"), control2.getProperty("y") });
-                    nodes.push_back(node);
-                }
+        /**
+         * Write every node into a tree named `id`, in the form fromValueTree reads.
+         */
+        ValueTree toValueTree(const juce::Identifier& id) const {
+            ValueTree tree{id};
+            const SpinLock::ScopedLockType sl (lock);
+            for (size_t i = 0; i < nodes.size(); i++)
+                tree.addChild (nodes[i]->toValueTree ("pt" + String (i)), -1, nullptr);
+            return tree;
+        }
+
+        /**
+         * Rebuild the curve from a tree written by toValueTree.
+         *
+         * The tree may come from an arbitrary host blob, so every point is clamped into range, the anchors are put in
+         * order and pinned to the ends of the X axis, and unknown curve types fall back to Linear. Trees that would not
+         * describe a usable curve (fewer than two nodes) are rejected and leave the current curve untouched.
+         *
+         * \return true if the curve was replaced
+         */
+        bool fromValueTree(const ValueTree& tree) {
+            if (tree.getNumChildren() < 2)
+                return false;
+
+            auto readPoint = [this](const ValueTree& pt, const PointType& fallback)
+            {
+                const auto x = static_cast<double> (pt.getProperty ("x", fallback.x));
+                const auto y = static_cast<double> (pt.getProperty ("y", fallback.y));
+                return PointType{
+                    std::isfinite (x) ? jlimit (minX, maxX, static_cast<T> (x)) : fallback.x,
+                    std::isfinite (y) ? jlimit (minY, maxY, static_cast<T> (y)) : fallback.y
+                };
+            };
+
+            std::vector<std::shared_ptr<Node>> newNodes;
+            newNodes.reserve (static_cast<size_t> (tree.getNumChildren()));
+            for (int i = 0; i < tree.getNumChildren(); i++) {
+                auto child = tree.getChild(i);
+                const auto anchor = readPoint (child.getChildWithName("anchor"), PointType{minX, minY});
+                auto node = std::make_shared<Node>(anchor);
+                const int curveType = child.getProperty("curveType", 0);
+                node->curveType = isPositiveAndBelow (curveType, CurveTypeCount) ? static_cast<CurveType> (curveType) : CurveType::Linear;
+                node->setControlPt1(readPoint (child.getChildWithName("control1"), anchor));
+                node->setControlPt2(readPoint (child.getChildWithName("control2"), anchor));
+                newNodes.push_back(node);
             }
+
+            std::stable_sort (newNodes.begin(), newNodes.end(), [](const auto& a, const auto& b) { return a->anchor.pt.x < b->anchor.pt.x; });
+            newNodes.front()->anchor.setX (minX);
+            newNodes.back()->anchor.setX (maxX);
+
+            const SpinLock::ScopedLockType sl (lock);
+            nodes.swap (newNodes);
+            ++revision;
+            return true;
         }
 
         /**
@@ -111,12 +150,26 @@ namespace aas
         T minX, maxX;
         T minY, maxY;
         std::vector<std::shared_ptr<Node>> nodes;
+        /**
+         * Held by anything that changes the nodes, and by the audio thread while it evaluates them. Edits and paint()
+         * both happen on the message thread, so paint() reads without it.
+         */
+        juce::SpinLock lock;
+        /** Incremented whenever the nodes change, so that views know when to redraw */
+        std::atomic<int> revision{0};
+        /** Written by the audio thread for every transformed value */
+        std::atomic<T> lastInput{static_cast<T> (0)};
+        /** Message-thread mirror of lastInput, for the UI to listen to */
         juce::Value lastInputValue;
     };
 
     template <typename T>
     T CurveEditorModel<T>::compute(T input) {
         jassert (nodes.size() > 1);
+        if (nodes.size() < 2)
+            return minY;
+
+        input = std::isfinite (input) ? jlimit (minX, maxX, input) : minX;
         for (size_t i = 1; i < nodes.size(); i++) {
             const auto& lastNode = *nodes[i - 1];
             const auto& node = *nodes[i];
@@ -126,61 +179,10 @@ namespace aas
 
             jassert (lastAnchorPoint.x <= anchorPoint.x);
 
-            if (input <= anchorPoint.x) {
-                auto computeCubic = [](const PointType& p0, const PointType& p1, const PointType& p2, const PointType& p3, auto t)
-                {
-                    return p0 * std::pow (1 - t, 3.0) + p1 * 3 * std::pow (1 - t, 2.0) * t + p2 * 3 * (1 - t) * std::pow (t, 2.0) + p3 *
-                            std::pow (t, 3.0);
-                };
-
-                auto computeQuadratic = [](const PointType& p0, const PointType& p1, const PointType& p2, auto t)
-                {
-                    return p0 * std::pow (1 - t, 2.0) + p1 * 2 * (1 - t) * t + p2 * std::pow (t, 2.0);
-                };
-
-                switch (lastNode.curveType) {
-                case CurveType::Cubic:
-                    {
-                        const auto& ctrlPoint1 = lastNode.control1.pt;
-                        const auto& ctrlPoint2 = lastNode.control2.pt;
-                        float finalT = 0.0f;
-                        float minDist = -1.0f;
-                        for (int j = 0; j <= 100; j++) {
-                            const float t = static_cast<float> (j) / 100.0f;
-                            const float x = computeCubic (lastAnchorPoint, ctrlPoint1, ctrlPoint2, anchorPoint, t).x;
-                            const float distance = std::abs (x - input);
-                            if (distance < minDist || minDist < 0.0f) {
-                                finalT = t;
-                                minDist = distance;
-                            }
-                        }
-                        return computeCubic (lastAnchorPoint, ctrlPoint1, ctrlPoint2, anchorPoint, finalT).y;
-                    }
-                case CurveType::Quadratic:
-                    {
-                        const auto& ctrlPoint = lastNode.control1.pt;
-                        float finalT = 0.0f;
-                        float minDist = -1.0f;
-                        for (int j = 0; j <= 100; j++) {
-                            const float t = static_cast<float> (j) / 100.0f;
-                            const float x = computeQuadratic (lastAnchorPoint, ctrlPoint, anchorPoint, t).x;
-                            const float distance = std::abs (x - input);
-                            if (distance < minDist || minDist < 0.0f) {
-                                finalT = t;
-                                minDist = distance;
-                            }
-                        }
-                        return computeQuadratic (lastAnchorPoint, ctrlPoint, anchorPoint, finalT).y;
-                    }
-                default:
-                case CurveType::Linear:
-                    const auto slope = (anchorPoint.y - lastAnchorPoint.y) / (anchorPoint.x - lastAnchorPoint.x);
-                    return slope * (input - lastAnchorPoint.x) + lastAnchorPoint.y;
-                }
-            }
+            if (input <= anchorPoint.x)
+                return evaluateCurveSegment (lastNode.curveType, lastAnchorPoint, lastNode.control1.pt, lastNode.control2.pt, anchorPoint, input);
         }
-        jassertfalse; // TODO
-        return 0.0f;
+        return nodes.back()->anchor.pt.y;
     }
 
     template <typename T>
@@ -189,14 +191,58 @@ namespace aas
         using Handle = typename CurveEditorModel<T>::Handle;
         using Node = typename CurveEditorModel<T>::Node;
         using CurveType = typename CurveEditorModel<T>::CurveType;
+
+        /**
+         * One line of readout text. The text is formatted into a fixed buffer and only laid out again when it or the
+         * font changes, so drawing a readout whose value hasn't changed allocates nothing.
+         */
+        struct Readout {
+            /** Show two values, rounded to whole numbers, between the given brackets */
+            void set(const Font& newFont, char open, T first, T second, char close) {
+                char formatted[sizeof (text)];
+                std::snprintf (formatted, sizeof (formatted), "%c%.0f, %.0f%c", open, static_cast<double> (first),
+                               static_cast<double> (second), close);
+                if (std::strcmp (formatted, text) == 0 && newFont == font)
+                    return;
+
+                std::memcpy (text, formatted, sizeof (text));
+                font = newFont;
+                glyphs.clear();
+                glyphs.addLineOfText (font, text, 0.0f, 0.0f);
+                width = glyphs.getBoundingBox (0, -1, true).getWidth();
+            }
+
+            char text[32] = {};
+            Font font;
+            GlyphArrangement glyphs;
+            float width = 0.0f;
+        };
+
     public:
         explicit CurveEditor(CurveEditorModel<T>& model) :
-            model (model) {
+            model (model),
+            frameClock (*this, [this] { onFrame(); }) {
             lastInputValue.referTo (model.lastInputValue);
             lastInputValue.addListener (this);
         }
 
-        void drawReadableSingleLineText(Graphics& g, const typename CurveEditorModel<T>::PointType& baseline, const std::string& text,
+        ~CurveEditor() override {
+            worker.cancelAll();
+        }
+
+        /**
+         * \return true once the static layer that the last paint() asked for has been rendered. Lets an offscreen
+         * caller, e.g. a benchmark, wait for the worker. Message thread only.
+         */
+        bool isStaticLayerReady() const {
+            const SpinLock::ScopedLockType sl (layerLock);
+            return !(frontKey != requestedLayer);
+        }
+
+        /** Measure every paint into the given stats while they are enabled, or stop measuring if nullptr */
+        void setPerformanceStats(PerformanceStats* newStats) { stats = newStats; }
+
+        void drawReadableSingleLineText(Graphics& g, const typename CurveEditorModel<T>::PointType& baseline, const Readout& readout,
                                         int yThreshold = 25, int xThreshold = 25);
         void paint(Graphics& g) override;
         void mouseDown(const MouseEvent& event) override;
@@ -215,9 +261,48 @@ namespace aas
         std::shared_ptr<Node> getNextNode(const Node& fromNode);
         std::shared_ptr<Node> getPrevNode(const Node& fromNode);
 
+        /** Called on the message thread after every edit the user makes to the curve */
+        std::function<void()> onChange;
+
+        /**
+         * Ask for a repaint on the next display frame. However many requests arrive in between, the editor is only
+         * repainted once per frame.
+         */
+        void requestRepaint() { repaintPending = true; }
+
     private:
         PointType transformPointToScreenSpace(const PointType& p) const;
         PointType transformPointFromScreenSpace(const PointType& p) const;
+
+        /** What the static layer was, or is being, rendered for */
+        struct LayerKey {
+            int revision = -1;
+            int width = 0, height = 0;
+            float scale = 1.0f;
+            bool lowDetail = false;
+
+            bool operator!=(const LayerKey& other) const noexcept {
+                return revision != other.revision || width != other.width || height != other.height || scale != other.scale
+                       || lowDetail != other.lowDetail;
+            }
+        };
+
+        void requestStaticLayer(const LayerKey& key);
+        void renderStaticLayer(const LayerKey& key, const std::vector<Node>& nodes, const AffineTransform& transform);
+
+        /** Bump the model's revision and tell the owner, after any edit the user makes */
+        void edited() {
+            ++model.revision;
+            if (onChange)
+                onChange();
+        }
+
+        void onFrame() {
+            if (repaintPending) {
+                repaintPending = false;
+                repaint();
+            }
+        }
     private:
         const float POINT_SIZE = 10.0f;
         const float DISTANCE_THRESHOLD = POINT_SIZE * 2.0f;
@@ -225,16 +310,30 @@ namespace aas
         Handle* selectedHandle = nullptr;
         CurveEditorModel<T>& model;
         Value lastInputValue;
+        std::atomic<bool> repaintPending{true};
+        bool dragging = false;
+        Readout cursorReadout, curveReadout, lastInputReadout;
+        PerformanceStats* stats = nullptr;
+        FrameClock frameClock;
+
+        // The background, curve and grid, rendered by the worker. paint() draws frontLayer; the worker renders into
+        // backLayer and then swaps the two under layerLock.
+        mutable SpinLock layerLock;
+        Image frontLayer;
+        Image backLayer;
+        LayerKey frontKey;
+        LayerKey requestedLayer;
+        BackgroundWorker::Client worker;
     };
 
     template <typename T>
     void CurveEditor<T>::drawReadableSingleLineText(Graphics& g, const typename CurveEditorModel<T>::PointType& baseline,
-                                                    const std::string& text, int yThreshold, int xThreshold) {
+                                                    const Readout& readout, int yThreshold, int xThreshold) {
         juce::Justification textJustification (juce::Justification::centred);
         int screenSpaceYOffset = 0;
         int screenSpaceXOffset = 0;
         if (static_cast<int> (baseline.y) < yThreshold) {
-            screenSpaceYOffset = static_cast<int> (g.getCurrentFont().getAscent());
+            screenSpaceYOffset = static_cast<int> (readout.font.getAscent());
             textJustification = juce::Justification::right;
         }
         if (static_cast<int> (baseline.x) < xThreshold) {
@@ -244,14 +343,44 @@ namespace aas
         else if (static_cast<int> (baseline.x) > getWidth() - xThreshold) {
             textJustification = juce::Justification::right;
         }
-        g.drawSingleLineText (text, static_cast<int> (baseline.x) + screenSpaceXOffset, static_cast<int> (baseline.y) + screenSpaceYOffset,
-                              textJustification);
+
+        // Justified the way Graphics::drawSingleLineText() does it, but with the cached layout
+        float justificationOffset = 0.0f;
+        if (textJustification.testFlags (juce::Justification::right))
+            justificationOffset = readout.width;
+        else if (textJustification.testFlags (juce::Justification::horizontallyCentred))
+            justificationOffset = readout.width * 0.5f;
+        readout.glyphs.draw (g, AffineTransform::translation (static_cast<float> (static_cast<int> (baseline.x) + screenSpaceXOffset) - justificationOffset,
+                                                              static_cast<float> (static_cast<int> (baseline.y) + screenSpaceYOffset)));
     }
 
     template <typename T>
     void CurveEditor<T>::paint(Graphics& g) {
-        g.setColour (Colours::black);
-        g.fillRect (0, 0, getWidth(), getHeight());
+        const bool measuring = stats != nullptr && stats->enabled;
+        const ScopedMeasurement paintTime (measuring ? &stats->paintMs : nullptr);
+        if (measuring)
+            ++stats->numPaints;
+
+        // The background, curve and grid come pre-rendered from the worker. Only what follows the mouse is drawn here.
+        const LayerKey key{model.revision.load(), getWidth(), getHeight(), g.getInternalContext().getPhysicalPixelScaleFactor(), dragging};
+        if (key != requestedLayer) {
+            requestedLayer = key;
+            requestStaticLayer (key);
+        }
+
+        Image layer;
+        {
+            const SpinLock::ScopedLockType sl (layerLock);
+            layer = frontLayer;
+        }
+        if (layer.isValid()) {
+            // Until the layer for a new size arrives, the last one is stretched to fit
+            g.drawImage (layer, getLocalBounds().toFloat());
+        }
+        else {
+            g.setColour (Colours::black);
+            g.fillRect (0, 0, getWidth(), getHeight());
+        }
 
         // Record mouse coordinates in screen/model space
         const PointType screenSpaceMousePt = getMouseXYRelative().toFloat();
@@ -304,34 +433,8 @@ namespace aas
             }
         };
 
-        // Draw the actual curve
-        Path curve;
-        for (size_t i = 0; i < model.nodes.size(); i++) {
-            const auto transformedAnchorPoint = transformPointToScreenSpace (model.nodes[i]->anchor.pt);
-            if (i == 0)
-                curve.startNewSubPath (transformedAnchorPoint);
-            else {
-                CurveType curve_type = model.nodes[i - 1]->curveType;
-                if (curve_type == CurveType::Linear) {
-                    curve.lineTo (transformedAnchorPoint);
-                }
-                else if (curve_type == CurveType::Quadratic) {
-                    const auto transformedControlPoint1 = transformPointToScreenSpace (model.nodes[i - 1]->control1.pt);
-                    curve.quadraticTo (transformedControlPoint1.x, transformedControlPoint1.y, transformedAnchorPoint.x,
-                                       transformedAnchorPoint.y);
-                }
-                else if (curve_type == CurveType::Cubic) {
-                    const auto transformedControlPoint1 = transformPointToScreenSpace (model.nodes[i - 1]->control1.pt);
-                    const auto transformedControlPoint2 = transformPointToScreenSpace (model.nodes[i - 1]->control2.pt);
-                    curve.cubicTo (transformedControlPoint1.x, transformedControlPoint1.y, transformedControlPoint2.x,
-                                   transformedControlPoint2.y, transformedAnchorPoint.x, transformedAnchorPoint.y);
-                }
-            }
-            drawHandles (*model.nodes[i]);
-        }
-
-        g.setColour (Colours::whitesmoke);
-        g.strokePath (curve, PathStrokeType (1.0f));
+        for (const auto& node : model.nodes)
+            drawHandles (*node);
 
         // Draw reference line from the mouse pointer to the curve
         if (!selectedHandle && contains (getMouseXYRelative())) {
@@ -345,17 +448,15 @@ namespace aas
 
             // Draw reference text describing point on the curve
             g.setColour (Colours::firebrick);
-            std::ostringstream ostr;
-            ostr << std::fixed << std::setprecision (0) << "[" << modelSpaceCurvePt.x << ", " << modelSpaceCurvePt.y << "]";
-            drawReadableSingleLineText (g, screenSpaceMousePt + PointType(0, g.getCurrentFont().getAscent() + 5), ostr.str(), 25 + g.getCurrentFont().getAscent() + 5);
+            curveReadout.set (g.getCurrentFont(), '[', modelSpaceCurvePt.x, modelSpaceCurvePt.y, ']');
+            drawReadableSingleLineText (g, screenSpaceMousePt + PointType(0, g.getCurrentFont().getAscent() + 5), curveReadout, 25 + g.getCurrentFont().getAscent() + 5);
         }
 
         // Draw reference text describing cursor coordinate
         {
             g.setColour(Colours::slategrey);
-            std::ostringstream ostr;
-            ostr << std::fixed << std::setprecision(0) << "(" << modelSpaceMousePt.x << ", " << modelSpaceMousePt.y << ")";
-            drawReadableSingleLineText(g, screenSpaceMousePt, ostr.str());
+            cursorReadout.set (g.getCurrentFont(), '(', modelSpaceMousePt.x, modelSpaceMousePt.y, ')');
+            drawReadableSingleLineText(g, screenSpaceMousePt, cursorReadout);
         }
 
         // Draw reference line for most recent input/output
@@ -365,27 +466,102 @@ namespace aas
             T outputValue = model.compute(inputValue);
             const auto screenSpaceCurvePt = transformPointToScreenSpace(PointType(inputValue, outputValue));
             g.drawVerticalLine(static_cast<int> (screenSpaceCurvePt.x), screenSpaceCurvePt.y, static_cast<float> (getHeight()));
-            std::ostringstream ostr;
-            ostr << std::fixed << std::setprecision(0) << "[" << inputValue << ", " << outputValue << "]";
-            drawReadableSingleLineText(g, screenSpaceCurvePt, ostr.str());
+            lastInputReadout.set (g.getCurrentFont(), '[', inputValue, outputValue, ']');
+            drawReadableSingleLineText(g, screenSpaceCurvePt, lastInputReadout);
         }
+    }
+
+    template <typename T>
+    void CurveEditor<T>::requestStaticLayer(const LayerKey& key) {
+        std::vector<Node> nodes;
+        {
+            const SpinLock::ScopedLockType sl (model.lock);
+            nodes.reserve (model.nodes.size());
+            for (const auto& node : model.nodes)
+                nodes.push_back (*node);
+        }
+        worker.post (0, BackgroundWorker::Priority::Low, [this, key, nodes = std::move (nodes), transform = screenSpaceTransform]
+        {
+            renderStaticLayer (key, nodes, transform);
+        });
+    }
 
+    /**
+     * Runs on the background worker, with copies of everything it needs from the message thread.
+     */
+    template <typename T>
+    void CurveEditor<T>::renderStaticLayer(const LayerKey& key, const std::vector<Node>& nodes, const AffineTransform& transform) {
+        if (key.width <= 0 || key.height <= 0)
+            return;
 
-        // Draw grid
-        auto numXTicks = 10; // TODO: Make these editable parameters
-        auto numYTicks = 10;
-        const Colour slightWhite = Colour::fromRGBA (255, 255, 255, 50);
-        g.setColour (slightWhite);
-        for (auto i = 0; i < numXTicks; i++) {
-            T currX = (model.maxX - model.minX) / static_cast<T> (numXTicks) * static_cast<T> (i) + model.minX;
-            PointType screenX = transformPointToScreenSpace (PointType (currX, 0));
-            g.drawVerticalLine (static_cast<int> (screenX.x), 0.0f, static_cast<float> (getHeight()));
+        // While dragging, a half-resolution preview renders in about a quarter of the time
+        const float scale = key.lowDetail ? key.scale * 0.5f : key.scale;
+        const int imageWidth = jmax (1, roundToInt (static_cast<float> (key.width) * scale));
+        const int imageHeight = jmax (1, roundToInt (static_cast<float> (key.height) * scale));
+        // paint() may still be drawing the image that was swapped out last time, in which case it can't be reused
+        if (backLayer.getWidth() != imageWidth || backLayer.getHeight() != imageHeight || backLayer.getReferenceCount() > 1)
+            backLayer = Image (Image::RGB, imageWidth, imageHeight, false, SoftwareImageType());
+
+        {
+            Graphics g (backLayer);
+            g.addTransform (AffineTransform::scale (static_cast<float> (imageWidth) / static_cast<float> (key.width),
+                                                    static_cast<float> (imageHeight) / static_cast<float> (key.height)));
+            g.setColour (Colours::black);
+            g.fillRect (0, 0, key.width, key.height);
+
+            auto toScreen = [&transform](const PointType& p) { return p.transformedBy (transform); };
+
+            // Draw the actual curve
+            Path curve;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                const auto transformedAnchorPoint = toScreen (nodes[i].anchor.pt);
+                if (i == 0)
+                    curve.startNewSubPath (transformedAnchorPoint);
+                else {
+                    CurveType curve_type = nodes[i - 1].curveType;
+                    if (curve_type == CurveType::Linear) {
+                        curve.lineTo (transformedAnchorPoint);
+                    }
+                    else if (curve_type == CurveType::Quadratic) {
+                        const auto transformedControlPoint1 = toScreen (nodes[i - 1].control1.pt);
+                        curve.quadraticTo (transformedControlPoint1.x, transformedControlPoint1.y, transformedAnchorPoint.x,
+                                           transformedAnchorPoint.y);
+                    }
+                    else if (curve_type == CurveType::Cubic) {
+                        const auto transformedControlPoint1 = toScreen (nodes[i - 1].control1.pt);
+                        const auto transformedControlPoint2 = toScreen (nodes[i - 1].control2.pt);
+                        curve.cubicTo (transformedControlPoint1.x, transformedControlPoint1.y, transformedControlPoint2.x,
+                                       transformedControlPoint2.y, transformedAnchorPoint.x, transformedAnchorPoint.y);
+                    }
+                }
+            }
+
+            g.setColour (Colours::whitesmoke);
+            g.strokePath (curve, PathStrokeType (1.0f));
+
+            // Draw grid
+            auto numXTicks = 10; // TODO: Make these editable parameters
+            auto numYTicks = 10;
+            const Colour slightWhite = Colour::fromRGBA (255, 255, 255, 50);
+            g.setColour (slightWhite);
+            for (auto i = 0; i < numXTicks; i++) {
+                T currX = (model.maxX - model.minX) / static_cast<T> (numXTicks) * static_cast<T> (i) + model.minX;
+                PointType screenX = toScreen (PointType (currX, 0));
+                g.drawVerticalLine (static_cast<int> (screenX.x), 0.0f, static_cast<float> (key.height));
+            }
+            for (auto i = 0; i < numYTicks; i++) {
+                T currY = (model.maxY - model.minY) / static_cast<T> (numYTicks) * static_cast<T> (i) + model.minY;
+                PointType screenY = toScreen (PointType (0, currY));
+                g.drawHorizontalLine (static_cast<int> (screenY.y), 0.0f, static_cast<float> (key.width));
+            }
         }
-        for (auto i = 0; i < numYTicks; i++) {
-            T currY = (model.maxY - model.minY) / static_cast<T> (numYTicks) * static_cast<T> (i) + model.minY;
-            PointType screenY = transformPointToScreenSpace (PointType (0, currY));
-            g.drawHorizontalLine (static_cast<int> (screenY.y), 0.0f, static_cast<float> (getWidth()));
+
+        {
+            const SpinLock::ScopedLockType sl (layerLock);
+            std::swap (frontLayer, backLayer);
+            frontKey = key;
         }
+        requestRepaint();
     }
 
     template <typename T>
@@ -404,7 +580,9 @@ namespace aas
             selectedHandle = closestHandle;
         }
         else if (event.mods.isRightButtonDown()) {
+            bool erased = false;
             if (closestHandle->parent != model.nodes.front().get() && closestHandle->parent != model.nodes.back().get()) {
+                const SpinLock::ScopedLockType sl (model.lock);
                 int toErase = -1;
                 for (int i = 0; i < model.nodes.size(); i++) {
                     if (model.nodes[i].get() == closestHandle->parent) {
@@ -414,85 +592,95 @@ namespace aas
                 }
                 if (toErase != -1) {
                     model.nodes.erase (model.nodes.begin() + toErase);
+                    erased = true;
                 }
                 selectedHandle = nullptr;
             }
+            // Right-clicking an end point erases nothing, so there is nothing to redraw or save
+            if (erased)
+                edited();
         }
 
-        repaint();
+        requestRepaint();
     }
 
     template <typename T>
     void CurveEditor<T>::mouseDrag(const MouseEvent& event) {
         if (selectedHandle) {
-            const PointType mousePt = event.getPosition().toFloat();
-            const PointType modelSpaceMousePt = transformPointFromScreenSpace (mousePt);
-            PointType selectedPoint = selectedHandle->pt;
-            CurveType curveType = selectedHandle->parent->curveType;
-
-            // Adjust selected point within the X and Y boundaries
-            selectedPoint = selectedPoint + 0.9f * (modelSpaceMousePt - selectedPoint);
-            selectedPoint.setX (jlimit (model.minX + 1, model.maxX - 1, selectedPoint.getX()));
-            selectedPoint.setY (jlimit (model.minY, model.maxY, selectedPoint.getY()));
-
-            // Lock the X position of the first and last anchor points
-            if (selectedHandle->parent == model.nodes.front().get() && &selectedHandle->parent->anchor == selectedHandle) {
-                selectedPoint.setX (model.minX);
-            }
-            else if (selectedHandle->parent == model.nodes.back().get() && &selectedHandle->parent->anchor == selectedHandle) {
-                selectedPoint.setX(model.maxX);
-            }
-
-            std::shared_ptr<Node> nextNode = getNextNode(*selectedHandle->parent);
-            std::shared_ptr<Node> prevNode = getPrevNode(*selectedHandle->parent);
-            if (selectedHandle == &selectedHandle->parent->anchor) {
-                // Push handles of prev/next nodes when moving an anchor
-                // Limit anchor so it doesn't cross prev/next anchors
-                if (prevNode) {
-                    selectedPoint.setX(jmax(selectedPoint.getX(), prevNode->anchor.pt.getX()));
-                    selectedHandle->parent->control1.pt.setX(jmax(selectedHandle->parent->control1.pt.getX(), prevNode->anchor.pt.getX()));
-                    selectedHandle->parent->control2.pt.setX(jmax(selectedHandle->parent->control2.pt.getX(), prevNode->anchor.pt.getX()));
-                    Handle& ctrl1 = prevNode->control1;
-                    ctrl1.setX(jmin(ctrl1.pt.getX(), selectedPoint.getX()));
-                    Handle& ctrl2 = prevNode->control2;
-                    ctrl2.setX(jmin(ctrl2.pt.getX(), selectedPoint.getX()));                    
+            {
+                const SpinLock::ScopedLockType sl (model.lock);
+                const PointType mousePt = event.getPosition().toFloat();
+                const PointType modelSpaceMousePt = transformPointFromScreenSpace (mousePt);
+                PointType selectedPoint = selectedHandle->pt;
+                CurveType curveType = selectedHandle->parent->curveType;
+
+                // Adjust selected point within the X and Y boundaries
+                selectedPoint = selectedPoint + 0.9f * (modelSpaceMousePt - selectedPoint);
+                selectedPoint.setX (jlimit (model.minX + 1, model.maxX - 1, selectedPoint.getX()));
+                selectedPoint.setY (jlimit (model.minY, model.maxY, selectedPoint.getY()));
+
+                // Lock the X position of the first and last anchor points
+                if (selectedHandle->parent == model.nodes.front().get() && &selectedHandle->parent->anchor == selectedHandle) {
+                    selectedPoint.setX (model.minX);
                 }
-                if (nextNode) {
-                    selectedPoint.setX(jmin(selectedPoint.getX(), nextNode->anchor.pt.getX()));
-                    selectedHandle->parent->control1.pt.setX(jmin(selectedHandle->parent->control1.pt.getX(), nextNode->anchor.pt.getX()));
-                    selectedHandle->parent->control2.pt.setX(jmin(selectedHandle->parent->control2.pt.getX(), nextNode->anchor.pt.getX()));
-                    Handle& ctrl1 = nextNode->control1;
-                    ctrl1.setX(jmax(ctrl1.pt.getX(), selectedPoint.getX()));
-                    Handle& ctrl2 = nextNode->control2;
-                    ctrl2.setX(jmax(ctrl2.pt.getX(), selectedPoint.getX()));
-                }
-                selectedHandle->parent->setAnchorPt(selectedPoint);
-            }
-            else if (curveType == CurveType::Quadratic || curveType == CurveType::Cubic) {
-                // Lock handles to be within the X coordinates of the anchor points
-                T minX = selectedHandle->parent->anchor.pt.getX();
-                selectedPoint.setX (jmax (minX, selectedPoint.getX()));
-                if (nextNode) {
-                    T maxX = nextNode->anchor.pt.getX();
-                    selectedPoint.setX (jmin (maxX, selectedPoint.getX()));
+                else if (selectedHandle->parent == model.nodes.back().get() && &selectedHandle->parent->anchor == selectedHandle) {
+                    selectedPoint.setX(model.maxX);
                 }
 
-                if (selectedHandle == &selectedHandle->parent->control1) {
-                    selectedHandle->parent->setControlPt1 (selectedPoint);
+                std::shared_ptr<Node> nextNode = getNextNode(*selectedHandle->parent);
+                std::shared_ptr<Node> prevNode = getPrevNode(*selectedHandle->parent);
+                if (selectedHandle == &selectedHandle->parent->anchor) {
+                    // Push handles of prev/next nodes when moving an anchor
+                    // Limit anchor so it doesn't cross prev/next anchors
+                    if (prevNode) {
+                        selectedPoint.setX(jmax(selectedPoint.getX(), prevNode->anchor.pt.getX()));
+                        selectedHandle->parent->control1.pt.setX(jmax(selectedHandle->parent->control1.pt.getX(), prevNode->anchor.pt.getX()));
+                        selectedHandle->parent->control2.pt.setX(jmax(selectedHandle->parent->control2.pt.getX(), prevNode->anchor.pt.getX()));
+                        Handle& ctrl1 = prevNode->control1;
+                        ctrl1.setX(jmin(ctrl1.pt.getX(), selectedPoint.getX()));
+                        Handle& ctrl2 = prevNode->control2;
+                        ctrl2.setX(jmin(ctrl2.pt.getX(), selectedPoint.getX()));                    
+                    }
+                    if (nextNode) {
+                        selectedPoint.setX(jmin(selectedPoint.getX(), nextNode->anchor.pt.getX()));
+                        selectedHandle->parent->control1.pt.setX(jmin(selectedHandle->parent->control1.pt.getX(), nextNode->anchor.pt.getX()));
+                        selectedHandle->parent->control2.pt.setX(jmin(selectedHandle->parent->control2.pt.getX(), nextNode->anchor.pt.getX()));
+                        Handle& ctrl1 = nextNode->control1;
+                        ctrl1.setX(jmax(ctrl1.pt.getX(), selectedPoint.getX()));
+                        Handle& ctrl2 = nextNode->control2;
+                        ctrl2.setX(jmax(ctrl2.pt.getX(), selectedPoint.getX()));
+                    }
+                    selectedHandle->parent->setAnchorPt(selectedPoint);
                 }
-                else if (selectedHandle == &selectedHandle->parent->control2 && curveType == CurveType::Cubic) {
-                    selectedHandle->parent->setControlPt2 (selectedPoint);
+                else if (curveType == CurveType::Quadratic || curveType == CurveType::Cubic) {
+                    // Lock handles to be within the X coordinates of the anchor points
+                    T minX = selectedHandle->parent->anchor.pt.getX();
+                    selectedPoint.setX (jmax (minX, selectedPoint.getX()));
+                    if (nextNode) {
+                        T maxX = nextNode->anchor.pt.getX();
+                        selectedPoint.setX (jmin (maxX, selectedPoint.getX()));
+                    }
+
+                    if (selectedHandle == &selectedHandle->parent->control1) {
+                        selectedHandle->parent->setControlPt1 (selectedPoint);
+                    }
+                    else if (selectedHandle == &selectedHandle->parent->control2 && curveType == CurveType::Cubic) {
+                        selectedHandle->parent->setControlPt2 (selectedPoint);
+                    }
                 }
             }
-
-            repaint();
+            dragging = true;
+            edited();
+            requestRepaint();
         }
     }
 
     template <typename T>
     void CurveEditor<T>::mouseUp(const MouseEvent& event) {
         selectedHandle = nullptr;
-        repaint();
+        // Ask for the full-detail layer in place of the drag preview
+        dragging = false;
+        requestRepaint();
     }
 
     template <typename T>
@@ -511,31 +699,36 @@ namespace aas
         auto closestPointDist = transformPointToScreenSpace (closestPt).getDistanceFrom (mousePt);
 
         if (closestHandle == &closestNode->anchor) {
-            CurveType newType = static_cast<CurveType> ((static_cast<int> (closestNode->curveType) + 1) % CurveEditorModel<
-                T>::CurveTypeCount);
-            closestNode->curveType = newType;
-
-            if (newType == CurveType::Linear) {
-                closestNode->setControlPt1 (closestNode->anchor.pt);
-            }
-            else if (newType == CurveType::Quadratic && closestNode != model.nodes.back().get()) {
-                constexpr int DEFAULT_CONTROL_DISTANCE = 5;
-                PointType controlPoint1 = closestNode->anchor.pt + PointType (DEFAULT_CONTROL_DISTANCE, 0);
-                closestHandle->parent->setControlPt1 (controlPoint1);
-            }
-            else if (newType == CurveType::Cubic && closestNode != model.nodes.back().get()) {
-                constexpr int DEFAULT_CONTROL_DISTANCE = 5;
-                PointType controlPoint1 = closestNode->anchor.pt + PointType (0, DEFAULT_CONTROL_DISTANCE);
-                PointType controlPoint2 = closestNode->anchor.pt + PointType (DEFAULT_CONTROL_DISTANCE, 0);
-                closestHandle->parent->setControlPt1 (controlPoint1);
-                closestHandle->parent->setControlPt2 (controlPoint2);
+            {
+                const SpinLock::ScopedLockType sl (model.lock);
+                CurveType newType = static_cast<CurveType> ((static_cast<int> (closestNode->curveType) + 1) % CurveEditorModel<
+                    T>::CurveTypeCount);
+                closestNode->curveType = newType;
+
+                if (newType == CurveType::Linear) {
+                    closestNode->setControlPt1 (closestNode->anchor.pt);
+                }
+                else if (newType == CurveType::Quadratic && closestNode != model.nodes.back().get()) {
+                    constexpr int DEFAULT_CONTROL_DISTANCE = 5;
+                    PointType controlPoint1 = closestNode->anchor.pt + PointType (DEFAULT_CONTROL_DISTANCE, 0);
+                    closestHandle->parent->setControlPt1 (controlPoint1);
+                }
+                else if (newType == CurveType::Cubic && closestNode != model.nodes.back().get()) {
+                    constexpr int DEFAULT_CONTROL_DISTANCE = 5;
+                    PointType controlPoint1 = closestNode->anchor.pt + PointType (0, DEFAULT_CONTROL_DISTANCE);
+                    PointType controlPoint2 = closestNode->anchor.pt + PointType (DEFAULT_CONTROL_DISTANCE, 0);
+                    closestHandle->parent->setControlPt1 (controlPoint1);
+                    closestHandle->parent->setControlPt2 (controlPoint2);
+                }
             }
+            edited();
+            requestRepaint();
         }
     }
 
     template <typename T>
     void CurveEditor<T>::mouseMove(const MouseEvent& event) {
-        repaint();
+        requestRepaint();
     }
 
     template <typename T>
@@ -549,7 +742,7 @@ namespace aas
 
     template <typename T>
     void CurveEditor<T>::valueChanged(Value& value) {
-        repaint();
+        requestRepaint();
     }
 
     template <typename T>
@@ -557,8 +750,13 @@ namespace aas
         for (size_t i = 0; i < model.nodes.size(); i++) {
             const auto& point = *model.nodes[i];
             if (p.x <= point.anchor.pt.x) {
-                model.nodes.emplace (model.nodes.begin() + i, std::make_shared<Node> (p));
-                repaint();
+                auto node = std::make_shared<Node> (p);
+                {
+                    const SpinLock::ScopedLockType sl (model.lock);
+                    model.nodes.emplace (model.nodes.begin() + i, std::move (node));
+                }
+                edited();
+                requestRepaint();
                 return;
             }
         }
@@ -0,0 +1,175 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /** How a curve runs from one anchor to the next, as saved in a node's curveType */
+    enum class CurveType {
+        Linear = 0,
+        Quadratic,
+        Cubic
+    };
+
+    static constexpr int CurveTypeCount = 3;
+
+    /**
+     * A point with the same arithmetic as juce::Point, for code that has to build without juce_graphics. Each
+     * product is worked out in the wider of the two types and stored back as T, exactly as juce::Point does, so a
+     * curve gives bit-identical results through either.
+     */
+    template <typename T>
+    struct CurvePoint {
+        T x, y;
+
+        CurvePoint operator+(const CurvePoint& other) const noexcept { return {x + other.x, y + other.y}; }
+
+        template <typename FactorType>
+        CurvePoint operator*(FactorType multiplier) const noexcept {
+            using CommonType = typename std::common_type<T, FactorType>::type;
+            return {static_cast<T> (static_cast<CommonType> (x) * static_cast<CommonType> (multiplier)),
+                    static_cast<T> (static_cast<CommonType> (y) * static_cast<CommonType> (multiplier))};
+        }
+    };
+
+    /**
+     * The curve's output at an input between two anchors. Curved segments are found by searching 101 points along
+     * the bezier for the one nearest the input.
+     *
+     * This is the one place a curve is evaluated, whether by the editor's CurveEditorModel or by CurveFunction, so
+     * that the plugin and anything embedding the curve engine map every input the same way.
+     */
+    template <typename T, typename PointType>
+    T evaluateCurveSegment(CurveType type, const PointType& start, const PointType& control1, const PointType& control2, const PointType& end, T input) {
+        auto computeCubic = [](const PointType& p0, const PointType& p1, const PointType& p2, const PointType& p3, auto t)
+        {
+            return p0 * std::pow (1 - t, 3.0) + p1 * 3 * std::pow (1 - t, 2.0) * t + p2 * 3 * (1 - t) * std::pow (t, 2.0) + p3 *
+                    std::pow (t, 3.0);
+        };
+
+        auto computeQuadratic = [](const PointType& p0, const PointType& p1, const PointType& p2, auto t)
+        {
+            return p0 * std::pow (1 - t, 2.0) + p1 * 2 * (1 - t) * t + p2 * std::pow (t, 2.0);
+        };
+
+        switch (type) {
+        case CurveType::Cubic:
+            {
+                float finalT = 0.0f;
+                float minDist = -1.0f;
+                for (int j = 0; j <= 100; j++) {
+                    const float t = static_cast<float> (j) / 100.0f;
+                    const float x = computeCubic (start, control1, control2, end, t).x;
+                    const float distance = std::abs (x - input);
+                    if (distance < minDist || minDist < 0.0f) {
+                        finalT = t;
+                        minDist = distance;
+                    }
+                }
+                return computeCubic (start, control1, control2, end, finalT).y;
+            }
+        case CurveType::Quadratic:
+            {
+                float finalT = 0.0f;
+                float minDist = -1.0f;
+                for (int j = 0; j <= 100; j++) {
+                    const float t = static_cast<float> (j) / 100.0f;
+                    const float x = computeQuadratic (start, control1, end, t).x;
+                    const float distance = std::abs (x - input);
+                    if (distance < minDist || minDist < 0.0f) {
+                        finalT = t;
+                        minDist = distance;
+                    }
+                }
+                return computeQuadratic (start, control1, end, finalT).y;
+            }
+        default:
+        case CurveType::Linear:
+            if (end.x <= start.x)
+                return end.y;
+            const auto slope = (end.y - start.y) / (end.x - start.x);
+            return slope * (input - start.x) + start.y;
+        }
+    }
+
+    /**
+     * A curve read straight from a saved state, for evaluating without the editor: only juce_core is needed.
+     *
+     * It reads the XML the way CurveEditorModel::fromValueTree reads the same tree and evaluates it the way
+     * CurveEditorModel::compute does, so both give the same output for every input. It is never changed after
+     * fromXml(), so any number of threads can call compute() at once.
+     */
+    template <typename T>
+    class CurveFunction {
+    public:
+        using PointType = CurvePoint<T>;
+
+        struct Node {
+            PointType anchor, control1, control2;
+            CurveType curveType = CurveType::Linear;
+        };
+
+        CurveFunction(T minX, T maxX, T minY, T maxY) :
+            minX (minX),
+            maxX (maxX),
+            minY (minY),
+            maxY (maxY) { }
+
+        /**
+         * Read a curveState element. Points are clamped into range, the anchors are put in order and pinned to the
+         * ends of the X axis, and unknown curve types fall back to Linear.
+         *
+         * \return false, leaving the curve untouched, if the element holds fewer than two nodes
+         */
+        bool fromXml(const XmlElement& curveState) {
+            auto readPoint = [this](const XmlElement* pt, const PointType& fallback)
+            {
+                const auto x = pt != nullptr ? pt->getDoubleAttribute ("x", fallback.x) : static_cast<double> (fallback.x);
+                const auto y = pt != nullptr ? pt->getDoubleAttribute ("y", fallback.y) : static_cast<double> (fallback.y);
+                return PointType{
+                    std::isfinite (x) ? jlimit (minX, maxX, static_cast<T> (x)) : fallback.x,
+                    std::isfinite (y) ? jlimit (minY, maxY, static_cast<T> (y)) : fallback.y
+                };
+            };
+
+            std::vector<Node> newNodes;
+            newNodes.reserve (static_cast<size_t> (curveState.getNumChildElements()));
+            for (auto* child = curveState.getFirstChildElement(); child != nullptr; child = child->getNextElement()) {
+                if (child->isTextElement())
+                    continue;
+                Node node;
+                node.anchor = readPoint (child->getChildByName ("anchor"), PointType{minX, minY});
+                const int curveType = child->getIntAttribute ("curveType", 0);
+                node.curveType = isPositiveAndBelow (curveType, CurveTypeCount) ? static_cast<CurveType> (curveType) : CurveType::Linear;
+                node.control1 = readPoint (child->getChildByName ("control1"), node.anchor);
+                node.control2 = readPoint (child->getChildByName ("control2"), node.anchor);
+                newNodes.push_back (node);
+            }
+            if (newNodes.size() < 2)
+                return false;
+
+            std::stable_sort (newNodes.begin(), newNodes.end(), [](const Node& a, const Node& b) { return a.anchor.x < b.anchor.x; });
+            newNodes.front().anchor.x = minX;
+            newNodes.back().anchor.x = maxX;
+            nodes = std::move (newNodes);
+            return true;
+        }
+
+        /** Map an input value onto the curve */
+        T compute(T input) const noexcept {
+            if (nodes.size() < 2)
+                return minY;
+
+            input = std::isfinite (input) ? jlimit (minX, maxX, input) : minX;
+            for (size_t i = 1; i < nodes.size(); i++) {
+                const auto& lastNode = nodes[i - 1];
+                if (input <= nodes[i].anchor.x)
+                    return evaluateCurveSegment (lastNode.curveType, lastNode.anchor, lastNode.control1, lastNode.control2, nodes[i].anchor, input);
+            }
+            return nodes.back().anchor.y;
+        }
+
+        T minX, maxX;
+        T minY, maxY;
+        std::vector<Node> nodes;
+    };
+}
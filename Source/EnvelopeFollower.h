@@ -0,0 +1,112 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * Follows the level of an audio signal at control rate, so the curve can be driven by e.g. a drum bus.
+     *
+     * The per-sample work (rectifying or squaring the signal and reducing each control period to a single number) is
+     * done by vector loops over the block. Attack/release smoothing then only runs once per control period.
+     */
+    class EnvelopeFollower {
+    public:
+        enum class Mode {
+            Peak = 0,
+            Rms
+        };
+
+        void prepare(double newSampleRate) {
+            sampleRate = newSampleRate;
+            reset();
+        }
+
+        void reset() noexcept {
+            envelope = 0.0;
+            periodPeak = 0.0;
+            periodSumOfSquares = 0.0;
+            periodFill = 0;
+        }
+
+        // Settings may be changed from any thread
+        void setMode(Mode newMode) noexcept { mode = static_cast<int> (newMode); }
+        void setAttackMs(float newAttackMs) noexcept { attackMs = jmax (0.1f, newAttackMs); }
+        void setReleaseMs(float newReleaseMs) noexcept { releaseMs = jmax (0.1f, newReleaseMs); }
+        void setRateHz(float newRateHz) noexcept { rateHz = jmax (1.0f, newRateHz); }
+
+        /**
+         * Consume a block of audio. For every control period that ends inside the block, calls
+         * onValue (samplePosition, level), where level is the smoothed envelope in 0..1.
+         */
+        template <typename Element, typename Callback>
+        void process(const AudioBuffer<Element>& audio, Callback&& onValue) noexcept {
+            const int numChannels = audio.getNumChannels();
+            const int numSamples = audio.getNumSamples();
+            if (numChannels == 0)
+                return;
+
+            const int periodSamples = jmax (1, roundToInt (sampleRate / rateHz.load()));
+            const double periodSeconds = periodSamples / sampleRate;
+            const double attackCoefficient = std::exp (-periodSeconds / (attackMs.load() * 0.001));
+            const double releaseCoefficient = std::exp (-periodSeconds / (releaseMs.load() * 0.001));
+            const bool rms = mode.load() == static_cast<int> (Mode::Rms);
+
+            int position = 0;
+            while (position < numSamples) {
+                const int n = jmin (numSamples - position, jmax (1, periodSamples - periodFill));
+                for (int channel = 0; channel < numChannels; channel++) {
+                    const auto* source = audio.getReadPointer (channel, position);
+                    if (rms) {
+                        periodSumOfSquares += sumOfSquares (source, n);
+                    }
+                    else {
+                        const auto range = FloatVectorOperations::findMinAndMax (source, n);
+                        periodPeak = jmax (periodPeak, static_cast<double> (-range.getStart()), static_cast<double> (range.getEnd()));
+                    }
+                }
+                position += n;
+                periodFill += n;
+
+                if (periodFill >= periodSamples) {
+                    const double level = rms ? std::sqrt (periodSumOfSquares / (periodFill * numChannels)) : periodPeak;
+                    const double coefficient = level > envelope ? attackCoefficient : releaseCoefficient;
+                    envelope = level + coefficient * (envelope - level);
+                    onValue (position - 1, jlimit (0.0, 1.0, envelope));
+
+                    periodPeak = 0.0;
+                    periodSumOfSquares = 0.0;
+                    periodFill = 0;
+                }
+            }
+        }
+
+    private:
+        template <typename Element>
+        static double sumOfSquares(const Element* source, int numSamples) noexcept {
+            // Independent accumulators let the compiler keep the loop in vector registers
+            Element lanes[8]{};
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+                for (int lane = 0; lane < 8; lane++)
+                    lanes[lane] += source[i + lane] * source[i + lane];
+
+            double sum = 0.0;
+            for (auto lane : lanes)
+                sum += lane;
+            for (; i < numSamples; i++)
+                sum += source[i] * source[i];
+            return sum;
+        }
+
+        double sampleRate = 44100.0;
+        std::atomic<int> mode{static_cast<int> (Mode::Peak)};
+        std::atomic<float> attackMs{10.0f};
+        std::atomic<float> releaseMs{150.0f};
+        std::atomic<float> rateHz{100.0f};
+
+        double envelope = 0.0;
+        double periodPeak = 0.0;
+        double periodSumOfSquares = 0.0;
+        int periodFill = 0;
+    };
+}
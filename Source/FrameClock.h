@@ -0,0 +1,51 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * Calls back once per display frame while a component is on screen, so that UI work can be batched up and done
+     * at most once per refresh.
+     *
+     * On JUCE 7 and later this follows the display's vertical blank through a VBlankAttachment. Older versions of
+     * JUCE have no vblank callback, so a timer at a typical refresh rate stands in for it.
+     */
+#if JUCE_MAJOR_VERSION >= 7
+    class FrameClock {
+    public:
+        FrameClock(Component& component, std::function<void()> onFrameIn) :
+            onFrame (std::move (onFrameIn)),
+            attachment (&component, [this] { onFrame(); }) { }
+
+    private:
+        std::function<void()> onFrame;
+        VBlankAttachment attachment;
+
+        JUCE_DECLARE_NON_COPYABLE (FrameClock)
+    };
+#else
+    class FrameClock : private Timer {
+    public:
+        static constexpr int fallbackRateHz = 60;
+
+        FrameClock(Component& componentIn, std::function<void()> onFrameIn) :
+            component (componentIn),
+            onFrame (std::move (onFrameIn)) {
+            startTimerHz (fallbackRateHz);
+        }
+
+        ~FrameClock() override { stopTimer(); }
+
+    private:
+        void timerCallback() override {
+            if (component.isShowing())
+                onFrame();
+        }
+
+        Component& component;
+        std::function<void()> onFrame;
+
+        JUCE_DECLARE_NON_COPYABLE (FrameClock)
+    };
+#endif
+}
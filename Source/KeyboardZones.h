@@ -0,0 +1,90 @@
+#pragma once
+#include "CurveEditor.h"
+
+namespace aas
+{
+    /**
+     * A note range, on one channel or all of them, with its own velocity curve and optionally its own output channel.
+     */
+    struct KeyboardZone {
+        int lowNote = 0;
+        int highNote = 127;
+        int channel = 0;       ///< 1-16, or 0 for any channel
+        int outputChannel = 0; ///< 1-16, or 0 to leave the channel alone
+        CurveEditorModel<float> curve{0.0f, 127.0f, 0.0f, 127.0f};
+
+        ValueTree toValueTree() const {
+            ValueTree tree{"zone", {
+                               {"lowNote", lowNote},
+                               {"highNote", highNote},
+                               {"channel", channel},
+                               {"outputChannel", outputChannel}
+                           }};
+            tree.addChild (curve.toValueTree ("curveState"), -1, nullptr);
+            return tree;
+        }
+
+        void fromValueTree(const ValueTree& tree) {
+            lowNote = jlimit (0, 127, static_cast<int> (tree.getProperty ("lowNote", 0)));
+            highNote = jlimit (lowNote, 127, static_cast<int> (tree.getProperty ("highNote", 127)));
+            channel = jlimit (0, 16, static_cast<int> (tree.getProperty ("channel", 0)));
+            outputChannel = jlimit (0, 16, static_cast<int> (tree.getProperty ("outputChannel", 0)));
+            curve.fromValueTree (tree.getChildWithName ("curveState"));
+        }
+    };
+
+    /**
+     * The zones as the audio thread sees them, baked ahead of time: a note-to-zone table per channel and a 7-bit
+     * velocity table per zone. Resolving a note costs one table read however many zones there are.
+     */
+    struct ZoneMap {
+        static constexpr int maxZones = 16;
+        static constexpr uint8 noZone = 0xff;
+
+        ZoneMap() {
+            for (auto& channelZones : noteToZone)
+                channelZones.fill (static_cast<uint8> (noZone));
+        }
+
+        using VelocityTables = std::array<std::array<float, 128>, maxZones>;
+
+        /**
+         * Where zones overlap, the one listed first wins.
+         *
+         * Velocity tables baked earlier from the same zones (see BakedTables.h) can be passed in, in which case no
+         * zone curve is evaluated.
+         */
+        void bake(const std::vector<std::unique_ptr<KeyboardZone>>& zones, const VelocityTables* bakedVelocityTables = nullptr) {
+            for (auto& channelZones : noteToZone)
+                channelZones.fill (static_cast<uint8> (noZone));
+
+            const int numZones = jmin (maxZones, static_cast<int> (zones.size()));
+            for (int zoneIndex = numZones; --zoneIndex >= 0;) {
+                auto& zone = *zones[(size_t) zoneIndex];
+                for (int channelIndex = 0; channelIndex < 16; channelIndex++) {
+                    if (zone.channel != 0 && zone.channel != channelIndex + 1)
+                        continue;
+                    for (int note = zone.lowNote; note <= zone.highNote; note++)
+                        noteToZone[(size_t) channelIndex][(size_t) note] = static_cast<uint8> (zoneIndex);
+                }
+
+                if (bakedVelocityTables != nullptr)
+                    velocityTables[(size_t) zoneIndex] = (*bakedVelocityTables)[(size_t) zoneIndex];
+                else
+                    for (int velocity = 0; velocity < 128; velocity++)
+                        velocityTables[(size_t) zoneIndex][(size_t) velocity] = zone.curve.compute (static_cast<float> (velocity));
+                outputChannels[(size_t) zoneIndex] = static_cast<uint8> (zone.outputChannel);
+            }
+        }
+
+        /** \return the zone index, or -1 if the note is not in any zone */
+        int zoneFor(int channelIndex, int note) const noexcept {
+            const auto zone = noteToZone[(size_t) channelIndex][(size_t) note];
+            return zone == noZone ? -1 : static_cast<int> (zone);
+        }
+
+        std::array<std::array<uint8, 128>, 16> noteToZone;
+        VelocityTables velocityTables{};
+        std::array<uint8, maxZones> outputChannels{};
+    };
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include "BackgroundWorker.h"
+
+namespace aas
+{
+    /**
+     * Records the MIDI going into and out of the processor to a compact binary log without blocking the audio thread.
+     *
+     * The audio thread serialises each event straight into a fixed-size byte ring, and requestWrite() has the shared
+     * BackgroundWorker drain the ring to disk. A block's records only become visible to the drain once the whole block
+     * is in the ring; a block that doesn't fit is dropped whole and its events counted, instead of waited for, so a
+     * log never holds events without the block they belong to, and memory use is bounded no matter how long the
+     * capture runs. The ring only exists while capturing.
+     *
+     * Log layout (little endian): "MTCP", uint32 version, float64 sample rate, uint32 state size and the processor
+     * state blob, then a sequence of records, each one uint8 kind, int64 sample time, uint16 size and then size bytes of
+     * payload. Every block starts with a Block record (int32 block size, int32 program, int32 input id, int32 output
+     * id) followed by the block's Input and Output events. The program is the one playing at the start of the block, or
+     * -1 for the live curve, and the ids are the routing it resolved to, the program's while one is playing. The last record of a completed log is a DroppedCount record whose payload
+     * is the int64 number of events that were dropped.
+     */
+    class MidiCapture {
+    public:
+        enum class RecordKind : uint8 {
+            Input = 0,
+            Output,
+            DroppedCount,
+            Block
+        };
+
+        static constexpr uint32 version = 3;
+        static constexpr int recordHeaderSize = 1 + 8 + 2;
+
+        MidiCapture() = default;
+
+        ~MidiCapture() { stop(); }
+
+        /**
+         * Start writing a new log to the given file, replacing its contents. Message thread only.
+         *
+         * \param state  the processor state at the start of the capture, so a replay can start from the same curve
+         */
+        bool start(const File& file, double sampleRate, const MemoryBlock& state) {
+            stop();
+
+            auto newStream = std::make_unique<FileOutputStream> (file);
+            if (!newStream->openedOk() || !newStream->setPosition (0) || newStream->truncate().failed())
+                return false;
+
+            newStream->write ("MTCP", 4);
+            newStream->writeInt (static_cast<int> (version));
+            newStream->writeDouble (sampleRate);
+            newStream->writeInt (static_cast<int> (state.getSize()));
+            newStream->write (state.getData(), state.getSize());
+
+            stream = std::move (newStream);
+            ring.assign (ringSize, 0);
+            fifo.reset();
+            dropped = 0;
+            active = true;
+            return true;
+        }
+
+        /**
+         * Have the background worker write out whatever is queued. Call this regularly (e.g. from a timer) while
+         * capturing; the ring holds about a second of dense MIDI.
+         */
+        void requestWrite() {
+            if (active)
+                worker.post (0, BackgroundWorker::Priority::Normal, [this] { drain(); });
+        }
+
+        /**
+         * Stop capturing, write out whatever is still queued and close the log. Message thread only.
+         */
+        void stop() {
+            if (!active.exchange (false))
+                return;
+
+            // Wait for a block the audio thread is writing, which saw the capture still active
+            while (writingBlock.load())
+                Thread::yield();
+
+            worker.cancelAll();
+            drain();
+            stream->writeByte (static_cast<char> (RecordKind::DroppedCount));
+            stream->writeInt64 (0);
+            stream->writeShort (8);
+            stream->writeInt64 (dropped.load());
+            stream->flush();
+            stream.reset();
+            std::vector<uint8>().swap (ring);
+        }
+
+        bool isActive() const noexcept { return active.load(); }
+        int64 getNumDroppedEvents() const noexcept { return dropped.load(); }
+
+        /**
+         * Start a block, along with the routing it is processed with, if capturing. Its events are added by push() and
+         * kept back until endBlock(). Audio thread only: never blocks or allocates.
+         *
+         * \return false if not capturing, in which case there is nothing to push and no endBlock() to call
+         */
+        bool beginBlock(int64 blockStartSample, int numSamples, int program, int midiInputId, int midiOutputId) noexcept {
+            // Announced before checking, so that stop() either sees the block or this sees the capture stopped
+            writingBlock = true;
+            if (!active.load()) {
+                writingBlock = false;
+                return false;
+            }
+
+            // All the free space, written to in order and only handed to the drain by endBlock()
+            int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+            fifo.prepareToWrite (fifo.getFreeSpace(), start1, size1, start2, size2);
+            block = {ring.data(), start1, size1, start2, size1 + size2};
+            blockEvents = 0;
+            blockFits = true;
+
+            const int32 payload[]{
+                ByteOrder::swapIfBigEndian (static_cast<int32> (numSamples)),
+                ByteOrder::swapIfBigEndian (static_cast<int32> (program)),
+                ByteOrder::swapIfBigEndian (static_cast<int32> (midiInputId)),
+                ByteOrder::swapIfBigEndian (static_cast<int32> (midiOutputId))
+            };
+            pushRecord (RecordKind::Block, blockStartSample, payload, static_cast<int> (sizeof (payload)));
+            return true;
+        }
+
+        /**
+         * Add every event in the buffer to the block started by beginBlock(). Audio thread only.
+         *
+         * \param blockStartSample  the running sample count at the start of the block, added to each event's position
+         */
+        void push(RecordKind kind, const MidiBuffer& buffer, int64 blockStartSample) noexcept {
+            for (const auto metadata : buffer) {
+                pushRecord (kind, blockStartSample + metadata.samplePosition, metadata.data, metadata.numBytes);
+                ++blockEvents;
+            }
+        }
+
+        /**
+         * Queue the block for writing if all of it fitted in the ring, or drop all of it. Audio thread only.
+         */
+        void endBlock() noexcept {
+            if (blockFits)
+                fifo.finishedWrite (block.written);
+            else
+                dropped += blockEvents;
+            writingBlock = false;
+        }
+
+    private:
+        void pushRecord(RecordKind kind, int64 sampleTime, const void* payload, int numBytes) noexcept {
+            const int total = recordHeaderSize + numBytes;
+            if (numBytes > 0xffff || block.written + total > block.capacity)
+                blockFits = false;
+            if (!blockFits)
+                return;
+
+            const auto time = ByteOrder::swapIfBigEndian (static_cast<uint64> (sampleTime));
+            const auto size = ByteOrder::swapIfBigEndian (static_cast<uint16> (numBytes));
+            block.write (&kind, 1);
+            block.write (&time, 8);
+            block.write (&size, 2);
+            block.write (payload, numBytes);
+        }
+
+        struct RingWriter {
+            uint8* ring;
+            int start1, size1, start2;
+            int capacity;
+            int written = 0;
+
+            void write(const void* source, int numBytes) noexcept {
+                const auto* bytes = static_cast<const uint8*> (source);
+                for (int i = 0; i < numBytes; i++, written++)
+                    ring[(size_t) (written < size1 ? start1 + written : start2 + written - size1)] = bytes[i];
+            }
+        };
+
+        void drain() {
+            const auto scope = fifo.read (fifo.getNumReady());
+            if (scope.blockSize1 > 0)
+                stream->write (ring.data() + scope.startIndex1, (size_t) scope.blockSize1);
+            if (scope.blockSize2 > 0)
+                stream->write (ring.data() + scope.startIndex2, (size_t) scope.blockSize2);
+        }
+
+        static constexpr auto ringSize = 1 << 20;
+        AbstractFifo fifo{ringSize};
+        // Allocated by start() and freed by stop(), so that an instance that isn't capturing doesn't hold it
+        std::vector<uint8> ring;
+        std::unique_ptr<FileOutputStream> stream;
+        std::atomic<bool> active{false};
+        // Set by the audio thread from beginBlock() to endBlock(), so that stop() never frees the ring under it
+        std::atomic<bool> writingBlock{false};
+        // The block being written, on the audio thread
+        RingWriter block{nullptr, 0, 0, 0, 0};
+        int blockEvents = 0;
+        bool blockFits = false;
+        std::atomic<int64> dropped{0};
+        BackgroundWorker::Client worker;
+
+        JUCE_DECLARE_NON_COPYABLE (MidiCapture)
+    };
+
+    /**
+     * A log written by MidiCapture, split back into the blocks it was recorded in.
+     *
+     * A log that ends partway through a record still loads, with every record before it, and sets truncated. The last
+     * block of such a log may be missing some of its events.
+     */
+    struct CapturedSession {
+        struct Block {
+            int64 startSample = 0;
+            int numSamples = 0;
+            /** The program playing at the start of the block, or -1 for the live curve */
+            int program = -1;
+            int midiInputId = 1;
+            int midiOutputId = 1;
+            MidiBuffer input;
+            MidiBuffer output;
+        };
+
+        Result load(const File& file) {
+            FileInputStream in (file);
+            if (!in.openedOk())
+                return Result::fail ("Cannot open " + file.getFullPathName());
+
+            char magic[4]{};
+            if (in.read (magic, 4) != 4 || std::memcmp (magic, "MTCP", 4) != 0)
+                return Result::fail ("Not a capture log");
+            if (static_cast<uint32> (in.readInt()) != MidiCapture::version)
+                return Result::fail ("Unsupported capture log version");
+
+            sampleRate = in.readDouble();
+            const auto stateSize = static_cast<size_t> (jmax (0, in.readInt()));
+            state.setSize (stateSize);
+            if (static_cast<size_t> (in.read (state.getData(), stateSize)) != stateSize)
+                return Result::fail ("Truncated state");
+
+            blocks.clear();
+            truncated = false;
+            HeapBlock<uint8> payload (0xffff);
+            while (!in.isExhausted()) {
+                // A log cut short, by a crash or a full disk, keeps everything up to its last whole record
+                if (in.getNumBytesRemaining() < MidiCapture::recordHeaderSize) {
+                    truncated = true;
+                    break;
+                }
+                const auto kind = static_cast<MidiCapture::RecordKind> (in.readByte());
+                const auto time = in.readInt64();
+                const int size = static_cast<uint16> (in.readShort());
+                if (in.read (payload, size) != size) {
+                    truncated = true;
+                    break;
+                }
+
+                if (kind == MidiCapture::RecordKind::Block && size == 16) {
+                    Block block;
+                    block.startSample = time;
+                    block.numSamples = static_cast<int> (ByteOrder::littleEndianInt (payload));
+                    block.program = static_cast<int> (ByteOrder::littleEndianInt (payload + 4));
+                    block.midiInputId = static_cast<int> (ByteOrder::littleEndianInt (payload + 8));
+                    block.midiOutputId = static_cast<int> (ByteOrder::littleEndianInt (payload + 12));
+                    blocks.push_back (std::move (block));
+                }
+                else if (kind == MidiCapture::RecordKind::DroppedCount && size == 8) {
+                    droppedEvents = static_cast<int64> (ByteOrder::littleEndianInt64 (payload));
+                }
+                else if (!blocks.empty() && (kind == MidiCapture::RecordKind::Input || kind == MidiCapture::RecordKind::Output)) {
+                    auto& block = blocks.back();
+                    auto& buffer = kind == MidiCapture::RecordKind::Input ? block.input : block.output;
+                    buffer.addEvent (payload, size, static_cast<int> (time - block.startSample));
+                }
+            }
+            return Result::ok();
+        }
+
+        double sampleRate = 0;
+        MemoryBlock state;
+        std::vector<Block> blocks;
+        int64 droppedEvents = 0;
+        // The log ended partway through a record
+        bool truncated = false;
+    };
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * Keeps the output within what a 31.25 kbaud DIN MIDI link can carry, so a hardware synth behind it never builds
+     * up a backlog.
+     *
+     * A token bucket counts the bytes the wire can take, refilled at 3125 bytes per second of sample time. Each event
+     * is costed in wire bytes, counting running status (the status byte is left out when it repeats). Notes, program
+     * changes, system messages and switch-like controllers (bank select, pedals, RPN/NRPN, channel mode) are always
+     * sent in order and may overdraw the bucket. Continuous data (other controllers, pitch bend, aftertouch) is only
+     * sent when the bucket can pay for it. Otherwise it waits in a fixed table with one slot per channel and
+     * controller, where a newer value replaces an older one. Waiting slots are sent oldest first as the bucket refills,
+     * so a stream is thinned but always ends on its last value, and no channel is starved.
+     *
+     * All state is fixed-size, so process() never allocates once prepare() has been called.
+     */
+    class MidiRateLimiter {
+    public:
+        static constexpr double wireBytesPerSecond = 31250.0 / 10.0;
+        /** How far the bucket can fill while the wire is idle, i.e. the largest burst sent at full speed */
+        static constexpr double bucketBytes = 32.0;
+
+        void prepare(double newSampleRate, int maximumBlockSize) {
+            bytesPerSample = wireBytesPerSecond / newSampleRate;
+            // Limiting only ever thins the output, but held values can add a few events to a block
+            output.ensureSize (static_cast<size_t> (maximumBlockSize + numSlots) * 4);
+            reset();
+        }
+
+        void reset() noexcept {
+            tokens = bucketBytes;
+            time = 0;
+            runningStatus = 0;
+            pending.fill (false);
+            queueHead = 0;
+            queueSize = 0;
+        }
+
+        bool hasPending() const noexcept { return queueSize > 0; }
+
+        /** Controllers whose individual values matter, and which must stay in order with the notes around them */
+        static bool isSwitchController(int controller) noexcept {
+            return controller == 0 || controller == 32                  // Bank select
+                   || (controller >= 64 && controller <= 69)             // Pedals and holds
+                   || controller == 6 || controller == 38                // Data entry
+                   || (controller >= 96 && controller <= 101)            // Data increment/decrement, NRPN and RPN
+                   || controller >= 120;                                 // Channel mode messages
+        }
+
+        /**
+         * Thin the block's events to fit the wire. Events that cannot be sent yet are held for later blocks.
+         */
+        void process(MidiBuffer& midi, int numSamples) noexcept {
+            if (numSamples <= 0)
+                return;
+
+            output.clear();
+            for (const auto metadata : midi) {
+                const int position = jlimit (0, numSamples - 1, metadata.samplePosition);
+                sendPending (position);
+                refill (position);
+
+                const int slot = getSlot (metadata.data, metadata.numBytes);
+                if (slot < 0) {
+                    send (metadata.data, metadata.numBytes, position);
+                }
+                else if (!hasPending() && tokens >= getCost (metadata.data[0], metadata.numBytes)) {
+                    send (metadata.data, metadata.numBytes, position);
+                }
+                else {
+                    if (!pending[(size_t) slot]) {
+                        pending[(size_t) slot] = true;
+                        queue[(size_t) ((queueHead + queueSize++) % numSlots)] = static_cast<uint16> (slot);
+                    }
+                    auto& message = pendingMessages[(size_t) slot];
+                    message.fill (0);
+                    std::copy (metadata.data, metadata.data + metadata.numBytes, message.begin());
+                    pendingSizes[(size_t) slot] = static_cast<uint8> (metadata.numBytes);
+                }
+            }
+            sendPending (numSamples - 1);
+            refill (numSamples);
+            time -= numSamples;
+            midi.swapWith (output);
+        }
+
+        /**
+         * Add every held event to the start of the block, e.g. when limiting is switched off, so no stream is left
+         * short of its last value.
+         */
+        void releasePending(MidiBuffer& midi) noexcept {
+            for (; queueSize > 0; queueSize--, queueHead = (queueHead + 1) % numSlots) {
+                const auto slot = queue[(size_t) queueHead];
+                pending[slot] = false;
+                midi.addEvent (pendingMessages[slot].data(), pendingSizes[slot], 0);
+            }
+            runningStatus = 0;
+        }
+
+    private:
+        // One slot per channel for each controller, each note's poly aftertouch, pitch bend and channel pressure
+        static constexpr int slotsPerChannel = 128 + 128 + 2;
+        static constexpr int numSlots = 16 * slotsPerChannel;
+
+        /** \return where the event waits if it has to, or -1 if it must always go out, in order */
+        static int getSlot(const uint8* data, int numBytes) noexcept {
+            if (numBytes < 2)
+                return -1;
+            const int channelIndex = data[0] & 0x0f;
+            switch (data[0] & 0xf0) {
+                case 0xa0: return channelIndex * slotsPerChannel + 128 + (data[1] & 0x7f);
+                case 0xb0: return isSwitchController (data[1]) ? -1 : channelIndex * slotsPerChannel + (data[1] & 0x7f);
+                case 0xd0: return channelIndex * slotsPerChannel + 256;
+                case 0xe0: return channelIndex * slotsPerChannel + 257;
+                default:   return -1;
+            }
+        }
+
+        int getCost(uint8 status, int numBytes) const noexcept {
+            return status == runningStatus ? numBytes - 1 : numBytes;
+        }
+
+        void refill(int position) noexcept {
+            tokens = jmin (bucketBytes, tokens + static_cast<double> (jmax (0, position - time)) * bytesPerSample);
+            time = jmax (time, position);
+        }
+
+        void send(const uint8* data, int numBytes, int position) noexcept {
+            const uint8 status = data[0];
+            if (status < 0xf0) {
+                tokens -= getCost (status, numBytes);
+                runningStatus = status;
+            }
+            else {
+                tokens -= numBytes;
+                // System common messages and sysex cancel running status, real-time messages don't
+                if (status < 0xf8)
+                    runningStatus = 0;
+            }
+            output.addEvent (data, numBytes, position);
+        }
+
+        /** Send held events, oldest first, as soon as the bucket can pay for each, up to the given position. */
+        void sendPending(int lastPosition) noexcept {
+            while (queueSize > 0) {
+                const auto slot = queue[(size_t) queueHead];
+                const auto& message = pendingMessages[slot];
+                const int cost = getCost (message[0], pendingSizes[slot]);
+                const int position = time + jmax (0, static_cast<int> (std::ceil ((cost - tokens) / bytesPerSample)));
+                if (position > lastPosition)
+                    return;
+
+                refill (position);
+                send (message.data(), pendingSizes[slot], position);
+                pending[slot] = false;
+                queueHead = (queueHead + 1) % numSlots;
+                queueSize--;
+            }
+        }
+
+        double bytesPerSample = wireBytesPerSecond / 44100.0;
+        double tokens = bucketBytes;
+        // Sample position, relative to the start of the current block, that tokens was last brought up to
+        int time = 0;
+        uint8 runningStatus = 0;
+
+        std::array<bool, numSlots> pending{};
+        std::array<std::array<uint8, 3>, numSlots> pendingMessages{};
+        std::array<uint8, numSlots> pendingSizes{};
+        // Waiting slots in the order they started waiting
+        std::array<uint16, numSlots> queue{};
+        int queueHead = 0;
+        int queueSize = 0;
+
+        MidiBuffer output;
+    };
+}
@@ -50,9 +50,21 @@
 
 #pragma once
 
+#include <algorithm>
 #include <iterator>
 
+#include "BackgroundWorker.h"
+#include "BakedTables.h"
 #include "CurveEditor.h"
+#include "ControlSignalRenderer.h"
+#include "EnvelopeFollower.h"
+#include "KeyboardZones.h"
+#include "MidiCapture.h"
+#include "MidiRateLimiter.h"
+#include "PerformanceStats.h"
+#include "ProgramSnapshot.h"
+#include "StreamDecimator.h"
+#include "TransformSurface.h"
 
 class MidiQueue {
 public:
@@ -73,7 +85,8 @@ private:
 };
 
 struct DropdownListModel {
-    int selectedItemId;
+    // Set from the editor, read by the audio thread
+    std::atomic<int> selectedItemId{1};
 };
 
 //==============================================================================
@@ -82,19 +95,19 @@ class MidiTransformerPluginProcessor : public AudioProcessor,
 public:
     MidiTransformerPluginProcessor() :
         AudioProcessor (getBusesLayout()),
-        curveEditorModel (0.0f, 127.0f, 0.0f, 127.0f) {
-        state.addChild ({
-                            "uiState", {
-                                {"width", 500},
-                                {"height", 300},
-                                {"midiInput", 1},
-                                {"midiOutput", 1}
-                            }
-                        }, -1, &undoManager);
+        curveEditorModel (0.0f, 127.0f, 0.0f, 127.0f),
+        upperCurveModel (0.0f, 127.0f, 0.0f, 127.0f) {
+        addDefaultUiState();
+        // The default surface is only baked once the plugin is about to be used (see bakeSurfaceIfNeeded()), since
+        // a restored session usually brings its own
         startTimerHz (60);
     }
 
-    ~MidiTransformerPluginProcessor() override { stopTimer(); }
+    ~MidiTransformerPluginProcessor() override {
+        stopTimer();
+        worker.cancelAll();
+        capture.stop();
+    }
 
     void processBlock(AudioBuffer<float>& audio, MidiBuffer& midi) override { process (audio, midi); }
     void processBlock(AudioBuffer<double>& audio, MidiBuffer& midi) override { process (audio, midi); }
@@ -102,86 +115,259 @@ public:
     bool isBusesLayoutSupported(const BusesLayout&) const override { return true; }
     bool isMidiEffect() const override { return true; }
     bool hasEditor() const override { return true; }
-    AudioProcessorEditor* createEditor() override { return new Editor (*this); }
+    AudioProcessorEditor* createEditor() override {
+        bakeSurfaceIfNeeded();
+        return new Editor (*this);
+    }
 
     const String getName() const override { return "MIDI Logger"; }
     bool acceptsMidi() const override { return true; }
     bool producesMidi() const override { return true; }
     double getTailLengthSeconds() const override { return 0.0; }
 
-    int getNumPrograms() override { return 0; }
-    int getCurrentProgram() override { return 0; }
+    int getNumPrograms() override { return numPrograms; }
+    int getCurrentProgram() override { return jmax (0, currentProgram.load()); }
 
-    void setCurrentProgram(int) override { }
+    /** Switch to a stored program. Empty slots are ignored. */
+    void setCurrentProgram(int index) override {
+        if (isPositiveAndBelow (index, numPrograms) && programs[(size_t) index] != nullptr)
+            currentProgram = index;
+    }
+
+    const String getProgramName(int index) override {
+        return isPositiveAndBelow (index, numPrograms) && programs[(size_t) index] != nullptr ? programs[(size_t) index]->name : String();
+    }
 
-    const String getProgramName(int) override { return {}; }
+    void changeProgramName(int index, const String& newName) override {
+        if (isPositiveAndBelow (index, numPrograms) && programs[(size_t) index] != nullptr) {
+            programs[(size_t) index]->name = newName;
+            programs[(size_t) index]->state.setProperty ("name", newName, nullptr);
+        }
+    }
+
+    /**
+     * Bake the current curves, zones and routing into a program slot, replacing whatever was there, and make it the
+     * current program. Message thread only.
+     */
+    void storeProgram(int index, const String& name) {
+        if (!isPositiveAndBelow (index, numPrograms))
+            return;
+        auto programState = createProgramState();
+        programState.setProperty ("name", name, nullptr);
+        setProgram (index, bakeProgram (programState));
+        currentProgram = index;
+        loadedProgram = index;
+    }
 
-    void changeProgramName(int, const String&) override { }
+    void clearProgram(int index) {
+        if (!isPositiveAndBelow (index, numPrograms))
+            return;
+        if (currentProgram == index)
+            currentProgram = -1;
+        setProgram (index, nullptr);
+    }
 
-    void prepareToPlay(double, int) override { }
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override {
+        bakeSurfaceIfNeeded();
+        controlSignal.prepare (sampleRate, maximumExpectedSamplesPerBlock);
+        envelopeFollower.prepare (sampleRate);
+        rateLimiter.prepare (sampleRate, maximumExpectedSamplesPerBlock);
+        decimator.prepare (sampleRate, maximumExpectedSamplesPerBlock);
+        // Room for a short message on every sample, so that only an unusually dense block grows it on the audio thread
+        transformedMidi.ensureSize (static_cast<size_t> (maximumExpectedSamplesPerBlock) * transformedBytesPerSample);
+        updateLatency();
+    }
 
     void releaseResources() override { }
 
     void getStateInformation(MemoryBlock& destData) override {
-        // Reset the nodes within the state ("curveState") and then re-add them
-        state.getOrCreateChildWithName("curveState", &undoManager).removeAllChildren (&undoManager);
-        for (size_t i = 0; i < curveEditorModel.nodes.size(); i++) {
-            const auto& node = curveEditorModel.nodes[i];
-            juce::Identifier id{"pt" + std::to_string (i)};
-            state.getChildWithName("curveState").addChild (node->toValueTree (id), -1, &undoManager);
+        writeCurveState ("curveState", curveEditorModel);
+        writeCurveState ("upperCurveState", upperCurveModel);
+
+        // Saving isn't an edit, so none of it goes through the undo manager, where every save would pile up a copy
+        // of the zones and the whole bank
+        auto zonesState = state.getOrCreateChildWithName ("zones", nullptr);
+        zonesState.removeAllChildren (nullptr);
+        for (const auto& zone : zones)
+            zonesState.addChild (zone->toValueTree(), -1, nullptr);
+
+        auto programsState = state.getOrCreateChildWithName ("programs", nullptr);
+        programsState.removeAllChildren (nullptr);
+        programsState.setProperty ("currentProgram", currentProgram.load(), nullptr);
+        for (int i = 0; i < numPrograms; i++) {
+            if (programs[(size_t) i] != nullptr) {
+                auto programState = programs[(size_t) i]->state.createCopy();
+                programState.setProperty ("index", i, nullptr);
+                programsState.addChild (programState, -1, nullptr);
+            }
         }
 
+        // The view state only joins the document here, so that it never has to be kept in step with it
+        storeUiState();
         const std::unique_ptr<juce::XmlElement> xmlState(state.createXml());
-        if (xmlState != nullptr)
+        if (xmlState != nullptr) {
+            xmlState->addChildElement (uiState.createXml().release());
+            if (uiState.getProperty ("embedTables"))
+                xmlState->addChildElement (createBakedTables().release());
             copyXmlToBinary (*xmlState, destData);
+        }
+    }
+
+    /**
+     * Start recording everything that goes into and comes out of process() to a binary log (see aas::MidiCapture).
+     */
+    bool startCapture(const File& file) {
+        MemoryBlock stateBlob;
+        getStateInformation (stateBlob);
+        return capture.start (file, getSampleRate(), stateBlob);
+    }
+    void stopCapture() { capture.stop(); }
+    bool isCapturing() const { return capture.isActive(); }
+    int64 getNumDroppedCaptureEvents() const { return capture.getNumDroppedEvents(); }
+
+    /** Select the routing by dropdown id, as the editor's dropdowns do. */
+    void setRouting(int midiInputId, int midiOutputId) {
+        midiInputModel.selectedItemId = sanitiseDropdownId (midiInputId, true);
+        midiOutputModel.selectedItemId = sanitiseDropdownId (midiOutputId);
+    }
+
+    /**
+     * Play a captured block with what it was recorded with: its program, or the live curve with the given routing for
+     * -1 or a program that isn't stored. Used when replaying a capture.
+     */
+    void setCapturedRouting(int program, int midiInputId, int midiOutputId) {
+        if (isPositiveAndBelow (program, numPrograms) && programs[(size_t) program] != nullptr) {
+            currentProgram = program;
+            return;
+        }
+        currentProgram = -1;
+        setRouting (midiInputId, midiOutputId);
     }
 
     void setStateInformation(const void* data, int size) override {
         const std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, size));
-        if (xmlState != nullptr) {
-            state = ValueTree::fromXml (*xmlState);
-            curveEditorModel.fromValueTree (state.getOrCreateChildWithName("curveState", &undoManager));
+        if (xmlState == nullptr || !xmlState->hasTagName (state.getType()))
+            return;
+
+        // Tables saved with the state are adopted as they are, wherever they were baked from exactly the curves and
+        // zones they are saved with, so that restoring a session need not evaluate any curve
+        std::unique_ptr<XmlElement> bakedTables (xmlState->getChildByName ("bakedTables"));
+        if (bakedTables != nullptr)
+            xmlState->removeChildElement (bakedTables.get(), false);
+
+        state = ValueTree::fromXml (*xmlState);
+        // Copied into the existing store rather than replacing it, so that an open editor stays attached to it
+        auto savedUiState = state.getChildWithName ("uiState");
+        state.removeChild (savedUiState, nullptr);
+        uiState.copyPropertiesFrom (savedUiState, nullptr);
+        addDefaultUiState();
+        const auto* liveTables = aas::BakedTables::find (bakedTables.get(), "live", aas::BakedTables::hash (state));
+        curveEditorModel.fromValueTree (state.getOrCreateChildWithName("curveState", nullptr));
+        upperCurveModel.fromValueTree (state.getOrCreateChildWithName("upperCurveState", nullptr));
+        if (liveTables == nullptr || !adoptSurface (*liveTables))
+            bakeSurface();
+
+        replaceZones (readZones (state.getChildWithName ("zones")), liveTables);
+
+        midiInputModel.selectedItemId = sanitiseDropdownId (uiState.getProperty ("midiInput"), true);
+        midiOutputModel.selectedItemId = sanitiseDropdownId (uiState.getProperty ("midiOutput"));
+        controlOutputEnabled = static_cast<bool> (uiState.getProperty ("controlOutput"));
+        dinLimitEnabled = static_cast<bool> (uiState.getProperty ("dinLimit"));
+        setThinningTolerance (uiState.getProperty ("thinTolerance"));
+        surfaceAxis = sanitiseSurfaceAxis (uiState.getProperty ("surfaceAxis"));
+        updateEnvelopeFollower();
+
+        // Every program is baked now, so that switching to one later costs nothing
+        const auto programsState = state.getChildWithName ("programs");
+        for (int i = 0; i < numPrograms; i++)
+            setProgram (i, nullptr);
+        for (const auto& programState : programsState) {
+            const int index = programState.getProperty ("index", -1);
+            if (isPositiveAndBelow (index, numPrograms))
+                setProgram (index, bakeProgram (programState, aas::BakedTables::find (bakedTables.get(), "program", aas::BakedTables::hash (programState))));
         }
+        // The live state was saved from the current program, so there is nothing to load
+        const int savedProgram = programsState.getProperty ("currentProgram", -1);
+        currentProgram = isPositiveAndBelow (savedProgram, numPrograms) && programs[(size_t) savedProgram] != nullptr ? savedProgram : -1;
+        loadedProgram = currentProgram;
+
+        if (auto* editor = dynamic_cast<Editor*> (getActiveEditor()))
+            editor->refreshFromProcessor();
     }
 
 private:
-    class Editor : public AudioProcessorEditor,
-                   private Value::Listener {
+    class Editor : public AudioProcessorEditor {
     public:
         static const int VELOCITY_DROPDOWN_ID = -1;
         static const int PITCH_DROPDOWN_ID = -2;
+        static const int SIDECHAIN_DROPDOWN_ID = -3;
+
+        // Items of the curve view dropdown, shown while a second axis is selected
+        enum CurveView {
+            LowCurveView = 1,
+            HighCurveView,
+            SurfaceMapView
+        };
 
         explicit Editor(MidiTransformerPluginProcessor& ownerIn) :
             AudioProcessorEditor (ownerIn),
             owner (ownerIn),
-            curveEditor (ownerIn.curveEditorModel) {
+            curveEditor (ownerIn.curveEditorModel),
+            upperCurveEditor (ownerIn.upperCurveModel),
+            surfaceView (ownerIn.surface),
+            performanceOverlay (ownerIn.editorStats),
+            frameClock (*this, [this] { onFrame(); }) {
             addAndMakeVisible (curveEditor);
+            addChildComponent (upperCurveEditor);
+            addChildComponent (surfaceView);
+            addAndMakeVisible (surfaceAxisDropdown);
+            addChildComponent (curveViewDropdown);
+            addAndMakeVisible (zoneDropdown);
+            addAndMakeVisible (addZoneButton);
+            addChildComponent (removeZoneButton);
+            addChildComponent (zoneRangeSlider);
+            addChildComponent (zoneChannelDropdown);
+            addChildComponent (zoneOutputDropdown);
+            addAndMakeVisible (programDropdown);
+            addAndMakeVisible (storeProgramButton);
+            addAndMakeVisible (clearProgramButton);
+            addAndMakeVisible (thinningSlider);
             addAndMakeVisible (midiInputDropdown);
             addAndMakeVisible (midiOutputDropdown);
+            addAndMakeVisible (captureButton);
+            addAndMakeVisible (controlOutputButton);
+            addAndMakeVisible (dinLimitButton);
+            addChildComponent (envelopeModeDropdown);
+            addChildComponent (attackSlider);
+            addChildComponent (releaseSlider);
+            addChildComponent (rateSlider);
+            addChildComponent (performanceOverlay);
 
-            setResizable (true, true);
-            lastUIWidth.referTo (owner.state.getChildWithName ("uiState").getPropertyAsValue ("width", &owner.undoManager));
-            lastUIHeight.referTo (owner.state.getChildWithName ("uiState").getPropertyAsValue ("height", &owner.undoManager));
-            setSize (lastUIWidth.getValue(), lastUIHeight.getValue());
+            // Right-click the background to show or hide the performance overlay
+            curveEditor.setPerformanceStats (&owner.editorStats);
+            upperCurveEditor.setPerformanceStats (&owner.editorStats);
+            performanceOverlay.setVisible (owner.uiState.getProperty ("performanceOverlay"));
 
-            lastUIWidth.addListener (this);
-            lastUIHeight.addListener (this);
+            setResizable (true, true);
+            setSize (owner.uiState.getProperty ("width"), owner.uiState.getProperty ("height"));
 
             // Setup input/output dropdowns
             midiInputDropdown.onChange = [&]
             {
-                lastMidiInput = midiInputDropdown.getSelectedId();
                 owner.midiInputModel.selectedItemId = midiInputDropdown.getSelectedId();
+                updateEnvelopeControlsVisibility();
+                stateEdited();
             };
             midiOutputDropdown.onChange = [&]
             {
-                lastMidiOutput = midiOutputDropdown.getSelectedId();
                 owner.midiOutputModel.selectedItemId = midiOutputDropdown.getSelectedId();
+                stateEdited();
             };
 
             // Fill input/output midi dropdowns
             midiInputDropdown.addItem ("Velocity", VELOCITY_DROPDOWN_ID);
             midiInputDropdown.addItem ("Pitch Bend", PITCH_DROPDOWN_ID);
+            midiInputDropdown.addItem ("Sidechain Level", SIDECHAIN_DROPDOWN_ID);
             midiOutputDropdown.addItem ("Velocity", VELOCITY_DROPDOWN_ID);
             midiOutputDropdown.addItem ("Pitch Bend", PITCH_DROPDOWN_ID);
             for (auto i = 0; i < 128; i++) {
@@ -197,123 +383,1114 @@ private:
                 midiOutputDropdown.addItem (controllerName, i + 1);
             }
 
-            // Connect dropdowns to the AudioProcessor's state object
-            lastMidiInput.referTo (owner.state.getChildWithName ("uiState").getPropertyAsValue ("midiInput", &owner.undoManager));
-            lastMidiOutput.referTo (owner.state.getChildWithName ("uiState").getPropertyAsValue ("midiOutput", &owner.undoManager));
-            midiInputDropdown.setSelectedId (static_cast<int> (lastMidiInput.getValue()));
-            midiOutputDropdown.setSelectedId (static_cast<int> (lastMidiOutput.getValue()));
+            // The processor holds the routing, and only writes it to the saved state when asked for it
+            midiInputDropdown.setSelectedId (owner.midiInputModel.selectedItemId, dontSendNotification);
+            midiOutputDropdown.setSelectedId (owner.midiOutputModel.selectedItemId, dontSendNotification);
+
+            // Capture the processor's MIDI traffic to a new log in the user's documents folder
+            captureButton.setToggleState (owner.isCapturing(), dontSendNotification);
+            captureButton.onClick = [&]
+            {
+                if (!captureButton.getToggleState()) {
+                    owner.stopCapture();
+                    return;
+                }
+
+                const auto folder = File::getSpecialLocation (File::userDocumentsDirectory).getChildFile ("MIDI-Transformer Captures");
+                const auto file = folder.getChildFile ("capture " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S") + ".mtcap");
+                if (folder.createDirectory().failed() || !owner.startCapture (file))
+                    captureButton.setToggleState (false, dontSendNotification);
+            };
+
+            // Render the transformed value as a control signal on the audio output, when the host gives us one
+            controlOutputButton.setToggleState (owner.controlOutputEnabled, dontSendNotification);
+            controlOutputButton.onClick = [&]
+            {
+                owner.controlOutputEnabled = controlOutputButton.getToggleState();
+            };
+
+            // Thin the output to what a DIN MIDI cable can carry
+            dinLimitButton.setToggleState (owner.dinLimitEnabled, dontSendNotification);
+            dinLimitButton.onClick = [&]
+            {
+                owner.dinLimitEnabled = dinLimitButton.getToggleState();
+            };
+
+            // Envelope follower settings, shown while the sidechain is the input
+            envelopeModeDropdown.addItem ("Peak", 1 + static_cast<int> (aas::EnvelopeFollower::Mode::Peak));
+            envelopeModeDropdown.addItem ("RMS", 1 + static_cast<int> (aas::EnvelopeFollower::Mode::Rms));
+            envelopeModeDropdown.getSelectedIdAsValue().referTo (owner.uiState.getPropertyAsValue ("envelopeMode", nullptr));
+            envelopeModeDropdown.onChange = [&] { owner.updateEnvelopeFollower(); };
+
+            auto setupEnvelopeSlider = [&](Slider& slider, const Identifier& property, double min, double max, const String& suffix)
+            {
+                slider.setSliderStyle (Slider::LinearHorizontal);
+                slider.setTextBoxStyle (Slider::TextBoxLeft, false, 70, 20);
+                slider.setRange (min, max, 1.0);
+                slider.setSkewFactorFromMidPoint (std::sqrt (min * max));
+                slider.setTextValueSuffix (suffix);
+                slider.getValueObject().referTo (owner.uiState.getPropertyAsValue (property, nullptr));
+                slider.onValueChange = [&] { owner.updateEnvelopeFollower(); };
+            };
+            setupEnvelopeSlider (attackSlider, "envelopeAttack", 1.0, 500.0, " ms att");
+            setupEnvelopeSlider (releaseSlider, "envelopeRelease", 1.0, 2000.0, " ms rel");
+            setupEnvelopeSlider (rateSlider, "envelopeRate", 5.0, 500.0, " Hz");
+            updateEnvelopeControlsVisibility();
+
+            // Second axis of the transform surface. Id 1 is off, 2 is the note number and 3 + n is CC n.
+            surfaceAxisDropdown.addItem ("2nd axis: Off", 1);
+            surfaceAxisDropdown.addItem ("2nd axis: Note Number", 2);
+            for (auto i = 0; i < 128; i++)
+                surfaceAxisDropdown.addItem ("2nd axis: CC " + String (i), 3 + i);
+            surfaceAxisDropdown.setSelectedId (owner.surfaceAxis + 1, dontSendNotification);
+            surfaceAxisDropdown.onChange = [&]
+            {
+                owner.surfaceAxis = owner.sanitiseSurfaceAxis (surfaceAxisDropdown.getSelectedId());
+                updateCurveView();
+                stateEdited();
+            };
+
+            curveViewDropdown.addItem ("Edit Low Curve", LowCurveView);
+            curveViewDropdown.addItem ("Edit High Curve", HighCurveView);
+            curveViewDropdown.addItem ("Show Surface", SurfaceMapView);
+            curveViewDropdown.setSelectedId (LowCurveView, dontSendNotification);
+            curveViewDropdown.onChange = [&] { updateCurveView(); };
+
+            curveEditor.onChange = [&]
+            {
+                owner.requestSurfaceBake();
+                stateEdited();
+            };
+            upperCurveEditor.onChange = curveEditor.onChange;
+
+            // Keyboard zones. Id 1 is the main curve, 2 + n is zone n.
+            addZoneButton.onClick = [&]
+            {
+                const int zoneIndex = owner.addZone();
+                if (zoneIndex >= 0) {
+                    refreshZoneDropdown (zoneIndex + 2);
+                    stateEdited();
+                }
+            };
+            removeZoneButton.onClick = [&]
+            {
+                const int zoneIndex = zoneDropdown.getSelectedId() - 2;
+                // The curve editor refers to the zone's curve, so it has to go first
+                releaseZoneEditor();
+                owner.removeZone (zoneIndex);
+                refreshZoneDropdown (1);
+                stateEdited();
+            };
+            zoneDropdown.onChange = [&] { selectZone(); };
+
+            zoneRangeSlider.setSliderStyle (Slider::TwoValueHorizontal);
+            zoneRangeSlider.setTextBoxStyle (Slider::NoTextBox, false, 0, 0);
+            zoneRangeSlider.setPopupDisplayEnabled (true, true, this);
+            zoneRangeSlider.setRange (0.0, 127.0, 1.0);
+            zoneRangeSlider.onValueChange = [&]
+            {
+                if (auto* zone = getSelectedZone()) {
+                    zone->lowNote = static_cast<int> (zoneRangeSlider.getMinValue());
+                    zone->highNote = static_cast<int> (zoneRangeSlider.getMaxValue());
+                    zonesEdited();
+                }
+            };
+
+            zoneChannelDropdown.addItem ("Any channel", 1);
+            zoneOutputDropdown.addItem ("Same channel", 1);
+            for (int channel = 1; channel <= 16; channel++) {
+                zoneChannelDropdown.addItem ("From ch " + String (channel), channel + 1);
+                zoneOutputDropdown.addItem ("To ch " + String (channel), channel + 1);
+            }
+            zoneChannelDropdown.onChange = [&]
+            {
+                if (auto* zone = getSelectedZone()) {
+                    zone->channel = zoneChannelDropdown.getSelectedId() - 1;
+                    zonesEdited();
+                }
+            };
+            zoneOutputDropdown.onChange = [&]
+            {
+                if (auto* zone = getSelectedZone()) {
+                    zone->outputChannel = zoneOutputDropdown.getSelectedId() - 1;
+                    zonesEdited();
+                }
+            };
+            refreshZoneDropdown (1);
+
+            // Program bank. Item id 1 + n is program n; selecting a stored program switches to it, and an empty slot
+            // just becomes the target for Store.
+            programDropdown.setTextWhenNothingSelected ("No program");
+            programDropdown.onChange = [&]
+            {
+                const int index = programDropdown.getSelectedId() - 1;
+                if (owner.getProgramName (index).isNotEmpty())
+                    owner.setCurrentProgram (index);
+                storeProgramButton.setEnabled (index >= 0);
+                clearProgramButton.setEnabled (owner.getProgramName (index).isNotEmpty());
+            };
+            storeProgramButton.onClick = [&]
+            {
+                const int index = programDropdown.getSelectedId() - 1;
+                owner.storeProgram (index, "Program " + String (index + 1));
+                refreshProgramDropdown();
+            };
+            clearProgramButton.onClick = [&]
+            {
+                owner.clearProgram (programDropdown.getSelectedId() - 1);
+                refreshProgramDropdown();
+            };
+            refreshProgramDropdown();
+
+            // How far a thinned controller stream may stray from the original, in 7-bit steps (0 is off)
+            thinningSlider.setSliderStyle (Slider::LinearHorizontal);
+            thinningSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 70, 20);
+            thinningSlider.setRange (0.0, 8.0, 0.5);
+            thinningSlider.setTextValueSuffix (" thin");
+            thinningSlider.getValueObject().referTo (owner.uiState.getPropertyAsValue ("thinTolerance", nullptr));
+            thinningSlider.onValueChange = [&] { owner.setThinningTolerance (static_cast<float> (thinningSlider.getValue())); };
+        }
+
+        /** Called once a re-baked surface is ready to show. */
+        void surfaceChanged() {
+            surfaceView.repaint();
+        }
+
+        /** Bring every control back in line with the processor, after a program or the whole state was loaded. */
+        void refreshFromProcessor() {
+            midiInputDropdown.setSelectedId (owner.midiInputModel.selectedItemId, dontSendNotification);
+            midiOutputDropdown.setSelectedId (owner.midiOutputModel.selectedItemId, dontSendNotification);
+            surfaceAxisDropdown.setSelectedId (owner.surfaceAxis + 1, dontSendNotification);
+            controlOutputButton.setToggleState (owner.controlOutputEnabled, dontSendNotification);
+            dinLimitButton.setToggleState (owner.dinLimitEnabled, dontSendNotification);
+            refreshProgramDropdown();
+            refreshZoneDropdown (1);
+            updateEnvelopeControlsVisibility();
+            curveEditor.repaint();
+            upperCurveEditor.repaint();
+            surfaceView.repaint();
+        }
+
+        void refreshProgramDropdown() {
+            const int selectedId = owner.currentProgram >= 0 ? owner.currentProgram + 1 : programDropdown.getSelectedId();
+            programDropdown.clear (dontSendNotification);
+            for (int i = 0; i < numPrograms; i++) {
+                const auto name = owner.getProgramName (i);
+                programDropdown.addItem (String (i + 1) + ": " + (name.isNotEmpty() ? name : "(empty)"), i + 1);
+            }
+            programDropdown.setSelectedId (selectedId, dontSendNotification);
+            storeProgramButton.setEnabled (selectedId > 0);
+            clearProgramButton.setEnabled (owner.getProgramName (selectedId - 1).isNotEmpty());
+        }
+
+        void refreshZoneDropdown(int idToSelect) {
+            zoneDropdown.clear (dontSendNotification);
+            zoneDropdown.addItem ("Main curve", 1);
+            for (size_t i = 0; i < owner.zones.size(); i++)
+                zoneDropdown.addItem ("Zone " + String (i + 1), static_cast<int> (i) + 2);
+            zoneDropdown.setSelectedId (idToSelect, dontSendNotification);
+            addZoneButton.setEnabled (owner.zones.size() < static_cast<size_t> (aas::ZoneMap::maxZones));
+            selectZone();
+        }
+
+        /** Drop the zone curve editor, which refers to a zone's curve, before the zones are replaced. */
+        void releaseZoneEditor() {
+            zoneCurveEditor.reset();
         }
 
         void paint(Graphics& g) override {
             g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
         }
 
+        void mouseDown(const MouseEvent& event) override {
+            if (!event.mods.isPopupMenu())
+                return;
+
+            PopupMenu menu;
+            menu.addItem ("Performance overlay", true, performanceOverlay.isVisible(), [safeThis = SafePointer<Editor> (this)]
+            {
+                if (safeThis != nullptr)
+                    safeThis->showPerformanceOverlay (!safeThis->performanceOverlay.isVisible());
+            });
+            menu.addItem ("Save baked tables with the state", true, owner.uiState.getProperty ("embedTables"), [safeThis = SafePointer<Editor> (this)]
+            {
+                if (safeThis != nullptr) {
+                    auto& uiState = safeThis->owner.uiState;
+                    uiState.setProperty ("embedTables", !static_cast<bool> (uiState.getProperty ("embedTables")), nullptr);
+                }
+            });
+            menu.showMenuAsync (PopupMenu::Options());
+        }
+
         void resized() override {
             auto bounds = getLocalBounds();
 
-            const auto inputMidiBounds = bounds.removeFromTop (50);
-            midiInputDropdown.setBounds (inputMidiBounds.withRight (getWidth() / 2));
-            midiOutputDropdown.setBounds (inputMidiBounds.withLeft (getWidth() / 2));
+            auto inputMidiBounds = bounds.removeFromTop (50);
+            captureButton.setBounds (inputMidiBounds.removeFromRight (80).reduced (5, 0));
+            controlOutputButton.setBounds (inputMidiBounds.removeFromRight (80).reduced (5, 0));
+            dinLimitButton.setBounds (inputMidiBounds.removeFromRight (80).reduced (5, 0));
+            midiInputDropdown.setBounds (inputMidiBounds.withRight (inputMidiBounds.getCentreX()));
+            midiOutputDropdown.setBounds (inputMidiBounds.withLeft (inputMidiBounds.getCentreX()));
+
+            auto surfaceBounds = bounds.removeFromTop (30).reduced (10, 3);
+            curveViewDropdown.setBounds (surfaceBounds.removeFromRight (surfaceBounds.getWidth() / 2).withTrimmedLeft (5));
+            surfaceAxisDropdown.setBounds (surfaceBounds);
+
+            auto zoneBounds = bounds.removeFromTop (30).reduced (10, 3);
+            zoneDropdown.setBounds (zoneBounds.removeFromLeft (110));
+            addZoneButton.setBounds (zoneBounds.removeFromLeft (30).withTrimmedLeft (5));
+            removeZoneButton.setBounds (zoneBounds.removeFromLeft (30).withTrimmedLeft (5));
+            zoneOutputDropdown.setBounds (zoneBounds.removeFromRight (110).withTrimmedLeft (5));
+            zoneChannelDropdown.setBounds (zoneBounds.removeFromRight (110).withTrimmedLeft (5));
+            zoneRangeSlider.setBounds (zoneBounds.withTrimmedLeft (5));
+
+            auto programBounds = bounds.removeFromTop (30).reduced (10, 3);
+            thinningSlider.setBounds (programBounds.removeFromRight (programBounds.getWidth() / 3).withTrimmedLeft (5));
+            clearProgramButton.setBounds (programBounds.removeFromRight (60).withTrimmedLeft (5));
+            storeProgramButton.setBounds (programBounds.removeFromRight (60).withTrimmedLeft (5));
+            programDropdown.setBounds (programBounds);
+
+            if (envelopeModeDropdown.isVisible()) {
+                auto envelopeBounds = bounds.removeFromTop (30).reduced (10, 3);
+                envelopeModeDropdown.setBounds (envelopeBounds.removeFromLeft (80));
+                const int sliderWidth = envelopeBounds.getWidth() / 3;
+                attackSlider.setBounds (envelopeBounds.removeFromLeft (sliderWidth));
+                releaseSlider.setBounds (envelopeBounds.removeFromLeft (sliderWidth));
+                rateSlider.setBounds (envelopeBounds);
+            }
             curveEditor.setBounds (bounds.removeFromBottom (bounds.proportionOfHeight (0.9f)).withTrimmedLeft (10).
                                           withTrimmedRight (10));
+            upperCurveEditor.setBounds (curveEditor.getBounds());
+            surfaceView.setBounds (curveEditor.getBounds());
+            if (zoneCurveEditor != nullptr)
+                zoneCurveEditor->setBounds (curveEditor.getBounds());
+            performanceOverlay.setBounds (curveEditor.getBounds().removeFromTop (90).removeFromRight (340).reduced (5));
 
-            lastUIWidth = getWidth();
-            lastUIHeight = getHeight();
+            // Outside the undo history, so that dragging the window corner doesn't fill it up
+            owner.uiState.setProperty ("width", getWidth(), nullptr);
+            owner.uiState.setProperty ("height", getHeight(), nullptr);
         }
 
     private:
-        void valueChanged(Value& value) override {
-            if (value == lastUIWidth || value == lastUIHeight)
-                setSize (lastUIWidth.getValue(), lastUIHeight.getValue());
+        /** Once per display frame: everything the UI takes from the audio thread is picked up here, together. */
+        void onFrame() {
+            owner.publishLastInput();
+            owner.requestTelemetryDrain();
+        }
+
+        void updateCurveView() {
+            const bool zoneSelected = zoneCurveEditor != nullptr;
+            const bool surfaceEnabled = surfaceAxisDropdown.getSelectedId() > 1;
+            const int view = surfaceEnabled ? curveViewDropdown.getSelectedId() : LowCurveView;
+            curveViewDropdown.setVisible (surfaceEnabled && !zoneSelected);
+            curveEditor.setVisible (!zoneSelected && view == LowCurveView);
+            upperCurveEditor.setVisible (!zoneSelected && view == HighCurveView);
+            surfaceView.setVisible (!zoneSelected && view == SurfaceMapView);
+        }
+
+        aas::KeyboardZone* getSelectedZone() {
+            const int zoneIndex = zoneDropdown.getSelectedId() - 2;
+            return isPositiveAndBelow (zoneIndex, static_cast<int> (owner.zones.size())) ? owner.zones[(size_t) zoneIndex].get() : nullptr;
+        }
+
+        /** Show the selected zone's settings, and swap the curve editor over to its curve. */
+        void selectZone() {
+            zoneCurveEditor.reset();
+            auto* zone = getSelectedZone();
+            if (zone != nullptr) {
+                zoneCurveEditor = std::make_unique<aas::CurveEditor<float>> (zone->curve);
+                zoneCurveEditor->onChange = [&] { zonesEdited(); };
+                zoneCurveEditor->setPerformanceStats (&owner.editorStats);
+                addAndMakeVisible (*zoneCurveEditor);
+                performanceOverlay.toFront (false);
+
+                zoneRangeSlider.setMinAndMaxValues (zone->lowNote, zone->highNote, dontSendNotification);
+                zoneChannelDropdown.setSelectedId (zone->channel + 1, dontSendNotification);
+                zoneOutputDropdown.setSelectedId (zone->outputChannel + 1, dontSendNotification);
+            }
+
+            for (auto* component : std::initializer_list<Component*>{&removeZoneButton, &zoneRangeSlider, &zoneChannelDropdown, &zoneOutputDropdown})
+                component->setVisible (zone != nullptr);
+            updateCurveView();
+            resized();
+        }
+
+        void showPerformanceOverlay(bool shouldShow) {
+            performanceOverlay.setVisible (shouldShow);
+            owner.uiState.setProperty ("performanceOverlay", shouldShow, nullptr);
+        }
+
+        /** Edits apply straight away, so they take the processor off whichever program it was playing. */
+        void stateEdited() {
+            owner.currentProgram = -1;
+        }
+
+        void zonesEdited() {
+            owner.bakeZones();
+            stateEdited();
+        }
+
+        void updateEnvelopeControlsVisibility() {
+            const bool visible = midiInputDropdown.getSelectedId() == SIDECHAIN_DROPDOWN_ID;
+            for (auto* component : std::initializer_list<Component*>{&envelopeModeDropdown, &attackSlider, &releaseSlider, &rateSlider})
+                component->setVisible (visible);
+            resized();
         }
 
         MidiTransformerPluginProcessor& owner;
 
         aas::CurveEditor<float> curveEditor;
+        aas::CurveEditor<float> upperCurveEditor;
+        aas::SurfaceView surfaceView;
+        juce::ComboBox surfaceAxisDropdown;
+        juce::ComboBox curveViewDropdown;
+        juce::ComboBox zoneDropdown;
+        juce::TextButton addZoneButton{"+"};
+        juce::TextButton removeZoneButton{"-"};
+        juce::Slider zoneRangeSlider;
+        juce::ComboBox zoneChannelDropdown;
+        juce::ComboBox zoneOutputDropdown;
+        std::unique_ptr<aas::CurveEditor<float>> zoneCurveEditor;
+        juce::ComboBox programDropdown;
+        juce::TextButton storeProgramButton{"Store"};
+        juce::TextButton clearProgramButton{"Clear"};
+        juce::Slider thinningSlider;
         juce::ComboBox midiInputDropdown;
         juce::ComboBox midiOutputDropdown;
+        juce::ToggleButton captureButton{"Capture"};
+        juce::ToggleButton controlOutputButton{"CV out"};
+        juce::ToggleButton dinLimitButton{"DIN limit"};
+        juce::ComboBox envelopeModeDropdown;
+        juce::Slider attackSlider, releaseSlider, rateSlider;
+        aas::PerformanceOverlay performanceOverlay;
 
-        Value lastMidiInput, lastMidiOutput;
-        Value lastUIWidth, lastUIHeight;
+        aas::FrameClock frameClock;
     };
 
     void timerCallback() override {
-        std::vector<MidiMessage> messages;
-        queue.pop (std::back_inserter (messages));
+        // While the editor is open, it drains the queue in step with the display instead
+        if (getActiveEditor() == nullptr)
+            requestTelemetryDrain();
+        capture.requestWrite();
+
+        // Pick up the last surface the worker baked, for the surface view
+        const int bakes = surfaceBakes;
+        if (bakes != surface.version) {
+            {
+                const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+                surface = audioSurface;
+            }
+            surface.version = bakes;
+            if (auto* editor = dynamic_cast<Editor*> (getActiveEditor()))
+                editor->surfaceChanged();
+        }
+
+        // The audio thread only switches which snapshot it reads; bring the editable state along here
+        const int program = currentProgram;
+        if (program != loadedProgram) {
+            loadedProgram = program;
+            if (program >= 0 && programs[(size_t) program] != nullptr)
+                loadProgramState (programs[(size_t) program]->state);
+            if (auto* editor = dynamic_cast<Editor*> (getActiveEditor()))
+                editor->refreshFromProcessor();
+        }
     }
 
     template <typename Element>
     void process(AudioBuffer<Element>& audio, MidiBuffer& midi) {
+        const auto blockStartSample = samplesProcessed;
+        samplesProcessed += audio.getNumSamples();
+
+        bool capturing = false;
+        if (capture.isActive()) {
+            // The routing the block is processed with, which is the playing program's while there is one
+            int program, midiInputId, midiOutputId;
+            {
+                const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+                const auto routing = getRouting (getActiveProgram());
+                program = routing.program != nullptr ? currentProgram.load() : -1;
+                midiInputId = routing.CC_IN + 1;
+                midiOutputId = routing.CC_OUT + 1;
+            }
+            capturing = capture.beginBlock (blockStartSample, audio.getNumSamples(), program, midiInputId, midiOutputId);
+        }
+        if (capturing)
+            capture.push (aas::MidiCapture::RecordKind::Input, midi, blockStartSample);
+
+        transformMidi (midi);
+
+        if (getBusCount (true) > 0 && getBus (true, 0)->isEnabled())
+            transformSidechain (getBusBuffer (audio, true, 0), midi);
+
+        // The signal goes to the output bus only, delayed as much as the decimator delays the MIDI it follows
+        if (controlOutputEnabled && getBusCount (false) > 0) {
+            auto output = getBusBuffer (audio, false, 0);
+            const int dropped = controlSignal.render (output, controlPoints.data(), numControlPoints, getThinningLatency());
+            if (dropped > 0)
+                editorStats.droppedControlPoints.fetch_add (dropped, std::memory_order_relaxed);
+        }
+        else {
+            controlSignal.discardPending();
+            audio.clear();
+        }
+
+        decimator.process (midi, audio.getNumSamples());
+
+        if (dinLimitEnabled)
+            rateLimiter.process (midi, audio.getNumSamples());
+        else if (rateLimiter.hasPending())
+            rateLimiter.releasePending (midi);
+
+        if (capturing) {
+            capture.push (aas::MidiCapture::RecordKind::Output, midi, blockStartSample);
+            capture.endBlock();
+        }
+        queue.push (midi);
+    }
+
+public:
+    /** What an event leaves behind for the events after it on the same channel */
+    struct ChannelState {
+        // Last note number or CC value seen on each channel, for the second axis
+        std::array<uint8, 16> secondAxisValues{};
+        // Output channel (1-16) of every note that is sounding on a zone with its own output channel, per input channel
+        std::array<std::array<uint8, 128>, 16> soundingNoteChannels{};
+    };
+
+    /**
+     * Everything transformMidi() carries from one event to the next. The curves, zones and programs it also reads only
+     * change with edits, so another instance restored from the same state and handed a checkpoint carries on exactly
+     * where this one stopped. That is what lets an offline run split one long track between threads.
+     */
+    struct TransformCheckpoint {
+        int program = -1;
+        float lastInput = 0.0f;
+        ChannelState channels;
+    };
+
+    TransformCheckpoint getTransformCheckpoint() {
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        return {currentProgram.load(), curveEditorModel.lastInput.load(), channelState};
+    }
+
+    void setTransformCheckpoint(const TransformCheckpoint& checkpoint) {
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        currentProgram = isPositiveAndBelow (checkpoint.program, numPrograms) ? checkpoint.program : -1;
+        curveEditorModel.lastInput = checkpoint.lastInput;
+        channelState = checkpoint.channels;
+    }
+
+    /**
+     * Move a checkpoint past a run of events, exactly as transformMidi() would, but without mapping any value or
+     * building any output. Costs a small fraction of transforming the same events.
+     */
+    void advanceTransformCheckpoint(TransformCheckpoint& checkpoint, const MidiBuffer& midi) {
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        auto routing = getRouting (checkpoint.program >= 0 ? programs[(size_t) checkpoint.program].get() : nullptr);
+        for (const auto it : midi) {
+            MidiMessage msg = it.getMessage();
+            if (msg.isProgramChange() && programs[(size_t) msg.getProgramChangeNumber()] != nullptr) {
+                checkpoint.program = msg.getProgramChangeNumber();
+                routing = getRouting (programs[(size_t) checkpoint.program].get());
+            }
+            trackEvent (msg, routing, checkpoint.channels);
+            readInputValue (msg, routing, checkpoint.lastInput);
+        }
+    }
+
+    /**
+     * Apply the curve to every matching event in the buffer, in place.
+     *
+     * The result depends only on the incoming events, the curve and the selected routing (never on the host's
+     * sample rate or block size), so recorded input can be replayed through it and compared byte-for-byte.
+     */
+    void transformMidi(MidiBuffer& midi) {
         using NumericType = decltype(curveEditorModel)::NumericType;
-        const int CC_IN = midiInputModel.selectedItemId - 1; // TODO: May have threading issues
-        const int CC_OUT = midiOutputModel.selectedItemId - 1;
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+
+        // Everything a program decides. A program change switches it for the rest of the block.
+        auto routing = getRouting (getActiveProgram());
 
-        MidiBuffer newMidiBuffer;
+        numControlPoints = 0;
+        // Swapped with the host's buffer at the end, so from then on each of the two keeps whatever room it has grown
+        auto& newMidiBuffer = transformedMidi;
+        newMidiBuffer.clear();
         for (auto it : midi) {
             MidiMessage msg = it.getMessage();
-            const auto timestamp = msg.getTimeStamp();
-            const auto sampleNumber = static_cast<int> (timestamp * getSampleRate());
-            NumericType inputValue = 0;
+            const auto sampleNumber = it.samplePosition;
+
+            if (msg.isProgramChange() && programs[(size_t) msg.getProgramChangeNumber()] != nullptr) {
+                currentProgram = msg.getProgramChangeNumber();
+                routing = getRouting (getActiveProgram());
+            }
+
+            const int channelIndex = msg.getChannel() - 1;
+            const int zone = trackEvent (msg, routing, channelState);
+
+            NumericType inputValue = curveEditorModel.lastInput.load();
             NumericType outputValue = 0;
-            if (msg.isController() && msg.getControllerNumber() == CC_IN) {
-                inputValue = static_cast<NumericType> (msg.getControllerValue());
+            if (!readInputValue (msg, routing, inputValue)) {
+                newMidiBuffer.addEvent (msg, sampleNumber);
+                continue;
             }
-            else if (CC_IN == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true)) {
-                inputValue = static_cast<NumericType> (msg.getVelocity());
-                // Don't re-add note on messages if we need to modify velocity
-                if (CC_OUT != Editor::VELOCITY_DROPDOWN_ID - 1) {
-                    newMidiBuffer.addEvent(msg, sampleNumber);
-                }
+            // Don't re-add note on messages if we need to modify velocity
+            if (routing.CC_IN == Editor::VELOCITY_DROPDOWN_ID - 1 && routing.CC_OUT != Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true))
+                newMidiBuffer.addEvent (msg, sampleNumber);
+
+            // Map original MIDI value to a new MIDI value using the function defined by the CurveEditor
+            curveEditorModel.lastInput = inputValue;
+            if (zone >= 0 && routing.CC_IN == Editor::VELOCITY_DROPDOWN_ID - 1) {
+                outputValue = routing.zoneMap->velocityTables[(size_t) zone][msg.getVelocity()];
             }
-            else if (CC_IN == Editor::PITCH_DROPDOWN_ID - 1 && msg.isPitchWheel()) {
-                inputValue = (static_cast<NumericType> (msg.getPitchWheelValue()) / static_cast<NumericType> (1 << 14)) *
-                        (curveEditorModel.maxY - curveEditorModel.minY);
+            else if (routing.axis != SurfaceAxisOff && channelIndex >= 0) {
+                const auto& model = curveEditorModel;
+                const auto x = (inputValue - model.minX) / (model.maxX - model.minX) * (aas::TransformSurface::size - 1);
+                const auto y = static_cast<float> (channelState.secondAxisValues[(size_t) channelIndex]);
+                outputValue = model.minY + routing.surfaceMap->lookup (x, y) / (aas::TransformSurface::size - 1) * (model.maxY - model.minY);
             }
-            else if (CC_OUT == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn(true)) {
-                inputValue = curveEditorModel.lastInputValue.getValue();
+            else if (routing.program != nullptr) {
+                outputValue = routing.program->compute (static_cast<float> (inputValue));
             }
             else {
-                newMidiBuffer.addEvent (msg, sampleNumber);
-                continue;
+                outputValue = curveEditorModel.compute (static_cast<float> (inputValue));
             }
 
-            // Map original MIDI value to a new MIDI value using the function defined by the CurveEditor
-            curveEditorModel.lastInputValue.setValue (inputValue);
-            outputValue = curveEditorModel.compute (static_cast<float> (inputValue));
+            const auto controlValue = (outputValue - curveEditorModel.minY) / (curveEditorModel.maxY - curveEditorModel.minY);
+            addControlPoint (sampleNumber, static_cast<float> (controlValue));
 
             MidiMessage newMsg;
-            if (CC_OUT >= 0) {
-                newMsg = juce::MidiMessage::controllerEvent (msg.getChannel(), CC_OUT, static_cast<int> (outputValue));
+            if (routing.CC_OUT >= 0) {
+                newMsg = juce::MidiMessage::controllerEvent (msg.getChannel(), routing.CC_OUT, jlimit (0, 127, static_cast<int> (outputValue)));
             }
-            else if (CC_OUT == Editor::PITCH_DROPDOWN_ID - 1) {
+            else if (routing.CC_OUT == Editor::PITCH_DROPDOWN_ID - 1) {
                 outputValue = (outputValue * (1 << 14)) / (curveEditorModel.maxY - curveEditorModel.minY);
-                newMsg = juce::MidiMessage::pitchWheel (msg.getChannel(), static_cast<int> (outputValue));
+                newMsg = juce::MidiMessage::pitchWheel (msg.getChannel(), jlimit (0, (1 << 14) - 1, static_cast<int> (outputValue)));
             }
-            else if (CC_OUT == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true)) {
+            else if (routing.CC_OUT == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true)) {
                 newMsg = juce::MidiMessage (msg);
                 newMsg.setVelocity ((outputValue - curveEditorModel.minY) / (curveEditorModel.maxY - curveEditorModel.minY));
             }
+            else {
+                // Nothing to write the value to (e.g. a controller routed to velocity)
+                continue;
+            }
 
             newMidiBuffer.addEvent (newMsg, sampleNumber);
         }
         midi.swapWith (newMidiBuffer);
-        queue.push (midi);
+    }
+
+private:
+    enum SurfaceAxis {
+        SurfaceAxisOff = 0,
+        SurfaceAxisNote,
+        SurfaceAxisFirstCC
+    };
+
+    /** Map the surface axis dropdown id onto a SurfaceAxis (plus the CC number for CC axes). */
+    static int sanitiseSurfaceAxis(const var& id) {
+        const int itemId = id;
+        return jlimit (1, SurfaceAxisFirstCC + 128, itemId) - 1;
+    }
+
+    /** Where transformMidi() reads events from and writes them to, as decided by a program or the live state */
+    struct Routing {
+        const aas::ProgramSnapshot* program;
+        const aas::ZoneMap* zoneMap;
+        const aas::TransformSurface* surfaceMap;
+        int CC_IN, CC_OUT, axis;
+    };
+
+    /** The routing of a program, or of the live state for nullptr. Call with curveEditorModel.lock held. */
+    Routing getRouting(const aas::ProgramSnapshot* program) const noexcept {
+        return {program,
+                program != nullptr ? &program->zones : &audioZones,
+                program != nullptr ? &program->surface : &audioSurface,
+                (program != nullptr ? program->midiInputId : midiInputModel.selectedItemId.load()) - 1,
+                (program != nullptr ? program->midiOutputId : midiOutputModel.selectedItemId.load()) - 1,
+                program != nullptr ? program->surfaceAxis : surfaceAxis.load()};
+    }
+
+    /**
+     * Note what an event leaves behind on its channel: the value of the surface's second axis, and the output channel
+     * of a note. A note on finds its zone in the table, and everything else about that note follows it to the same
+     * output channel, even if the zones have been edited since, so note events are moved to that channel here.
+     *
+     * \return the zone a note on starts, or -1
+     */
+    static int trackEvent(MidiMessage& msg, const Routing& routing, ChannelState& channels) {
+        const int channelIndex = msg.getChannel() - 1;
+        if (channelIndex < 0)
+            return -1;
+
+        if (routing.axis == SurfaceAxisNote && msg.isNoteOn (true))
+            channels.secondAxisValues[(size_t) channelIndex] = static_cast<uint8> (msg.getNoteNumber());
+        else if (routing.axis >= SurfaceAxisFirstCC && msg.isController() && msg.getControllerNumber() == routing.axis - SurfaceAxisFirstCC)
+            channels.secondAxisValues[(size_t) channelIndex] = static_cast<uint8> (msg.getControllerValue());
+
+        int zone = -1;
+        if (msg.isNoteOnOrOff() || msg.isAftertouch()) {
+            auto& soundingChannel = channels.soundingNoteChannels[(size_t) channelIndex][(size_t) msg.getNoteNumber()];
+            if (msg.isNoteOn()) {
+                zone = routing.zoneMap->zoneFor (channelIndex, msg.getNoteNumber());
+                soundingChannel = zone >= 0 ? routing.zoneMap->outputChannels[(size_t) zone] : 0;
+            }
+            if (soundingChannel != 0)
+                msg.setChannel (soundingChannel);
+            if (msg.isNoteOff())
+                soundingChannel = 0;
+        }
+        return zone;
+    }
+
+    /**
+     * Read the value the routing maps from an event. A note on that only has its velocity written takes the last
+     * input, so inputValue is left as it is.
+     *
+     * \return false if the routing passes the event through untouched
+     */
+    bool readInputValue(const MidiMessage& msg, const Routing& routing, float& inputValue) const noexcept {
+        if (msg.isController() && msg.getControllerNumber() == routing.CC_IN)
+            inputValue = static_cast<float> (msg.getControllerValue());
+        else if (routing.CC_IN == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true))
+            inputValue = static_cast<float> (msg.getVelocity());
+        else if (routing.CC_IN == Editor::PITCH_DROPDOWN_ID - 1 && msg.isPitchWheel())
+            inputValue = (static_cast<float> (msg.getPitchWheelValue()) / static_cast<float> (1 << 14)) * (curveEditorModel.maxY - curveEditorModel.minY);
+        else if (!(routing.CC_OUT == Editor::VELOCITY_DROPDOWN_ID - 1 && msg.isNoteOn (true)))
+            return false;
+        return true;
+    }
+
+    enum WorkerJob {
+        BakeSurfaceJob,
+        DrainTelemetryJob
+    };
+
+    /**
+     * Re-bake the transform surface from both curves and hand it to the audio thread. Safe on any thread but the
+     * audio thread: the curves are only read under their locks.
+     */
+    void bakeSurface() {
+        aas::TransformSurface::Row lowRow, highRow;
+        {
+            const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+            aas::TransformSurface::sampleCurve (curveEditorModel, lowRow);
+        }
+        {
+            const SpinLock::ScopedLockType sl (upperCurveModel.lock);
+            aas::TransformSurface::sampleCurve (upperCurveModel, highRow);
+        }
+        auto newSurface = std::make_unique<aas::TransformSurface>();
+        newSurface->bake (lowRow, highRow);
+
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        audioSurface = *newSurface;
+        ++surfaceBakes;
+    }
+
+    /**
+     * Bake the surface if it has never been baked or adopted. Loading a project restores every instance's state,
+     * with its saved tables, before any of them plays, so baking at construction would evaluate the default curves
+     * of every instance for nothing.
+     */
+    void bakeSurfaceIfNeeded() {
+        if (surfaceBakes == 0)
+            bakeSurface();
+    }
+
+    /** Hand the audio thread a surface saved by createBakedTables(). \return false if it is missing or damaged */
+    bool adoptSurface(const XmlElement& tables) {
+        aas::TransformSurface::Values values;
+        if (!aas::BakedTables::read (tables, "surface", values))
+            return false;
+
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        audioSurface.adopt (values);
+        ++surfaceBakes;
+        return true;
+    }
+
+    /**
+     * The live tables and those of every program, each tagged with a hash of the curves and zones it was baked from
+     * (see aas::BakedTables). Message thread only, once state and the program trees are up to date.
+     */
+    std::unique_ptr<XmlElement> createBakedTables() {
+        // A bake may still be queued behind the last edit, so bake now to be sure the surface matches the curves
+        bakeSurface();
+        aas::TransformSurface::Values surfaceValues;
+        aas::ZoneMap::VelocityTables velocityTables;
+        {
+            const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+            surfaceValues = audioSurface.values;
+            velocityTables = audioZones.velocityTables;
+        }
+
+        auto tables = std::make_unique<XmlElement> ("bakedTables");
+        tables->setAttribute ("format", aas::BakedTables::format);
+        auto* live = tables->createNewChildElement ("live");
+        live->setAttribute ("hash", aas::BakedTables::hash (state));
+        aas::BakedTables::write (*live, "surface", surfaceValues);
+        aas::BakedTables::write (*live, "zones", velocityTables);
+
+        for (const auto& program : programs) {
+            if (program != nullptr) {
+                auto* entry = tables->createNewChildElement ("program");
+                entry->setAttribute ("hash", aas::BakedTables::hash (program->state));
+                program->writeTables (*entry);
+            }
+        }
+        return tables;
+    }
+
+    /** Bake the surface on the background worker, once for any number of requests that arrive while it waits. */
+    void requestSurfaceBake() {
+        worker.post (BakeSurfaceJob, aas::BackgroundWorker::Priority::High, [this] { bakeSurface(); });
+    }
+
+    void requestTelemetryDrain() {
+        worker.post (DrainTelemetryJob, aas::BackgroundWorker::Priority::Low, [this] { drainTelemetry(); });
+    }
+
+    /** Copy the audio thread's last input into the Values the curve editors listen to. Message thread only. */
+    void publishLastInput() {
+        curveEditorModel.lastInputValue = curveEditorModel.lastInput.load();
+        upperCurveModel.lastInputValue = curveEditorModel.lastInput.load();
+    }
+
+    /** Empty the queue of processed MIDI. Only ever runs as DrainTelemetryJob, so it is the queue's only reader. */
+    void drainTelemetry() {
+        const bool measuring = editorStats.enabled;
+        const aas::ScopedMeasurement drainTime (measuring ? &editorStats.drainMs : nullptr);
+        drainedMessages.clear();
+        queue.pop (std::back_inserter (drainedMessages));
+        if (measuring)
+            editorStats.eventsDrained.add (static_cast<float> (drainedMessages.size()));
+    }
+
+    /**
+     * Re-bake the zones and hand them to the audio thread, adopting the velocity tables saved by createBakedTables()
+     * if they are given and usable. Message thread only.
+     */
+    void bakeZones(const XmlElement* bakedTables = nullptr) {
+        aas::ZoneMap::VelocityTables bakedVelocities;
+        const bool adopt = bakedTables != nullptr && aas::BakedTables::read (*bakedTables, "zones", bakedVelocities);
+        auto newZoneMap = std::make_unique<aas::ZoneMap>();
+        newZoneMap->bake (zones, adopt ? &bakedVelocities : nullptr);
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        audioZones = *newZoneMap;
+    }
+
+    /** \return the new zone's index, or -1 if there are already as many zones as there can be */
+    int addZone() {
+        if (zones.size() >= static_cast<size_t> (aas::ZoneMap::maxZones))
+            return -1;
+        zones.push_back (std::make_unique<aas::KeyboardZone>());
+        bakeZones();
+        return static_cast<int> (zones.size()) - 1;
+    }
+
+    static std::vector<std::unique_ptr<aas::KeyboardZone>> readZones(const ValueTree& zonesState) {
+        std::vector<std::unique_ptr<aas::KeyboardZone>> newZones;
+        for (const auto& zoneState : zonesState) {
+            if (newZones.size() == static_cast<size_t> (aas::ZoneMap::maxZones))
+                break;
+            newZones.push_back (std::make_unique<aas::KeyboardZone>());
+            newZones.back()->fromValueTree (zoneState);
+        }
+        return newZones;
+    }
+
+    void replaceZones(std::vector<std::unique_ptr<aas::KeyboardZone>> newZones, const XmlElement* bakedTables = nullptr) {
+        // An open editor may be showing one of the zones that are about to go away
+        auto* editor = dynamic_cast<Editor*> (getActiveEditor());
+        if (editor != nullptr)
+            editor->releaseZoneEditor();
+        zones = std::move (newZones);
+        bakeZones (bakedTables);
+        if (editor != nullptr)
+            editor->refreshZoneDropdown (1);
+    }
+
+    void removeZone(int zoneIndex) {
+        if (isPositiveAndBelow (zoneIndex, static_cast<int> (zones.size()))) {
+            zones.erase (zones.begin() + zoneIndex);
+            bakeZones();
+        }
+    }
+
+    /**
+     * The part of the state that a program stores: both curves, the zones, the routing and the second axis.
+     */
+    ValueTree createProgramState() const {
+        ValueTree programState{"program", {
+                                   {"midiInput", midiInputModel.selectedItemId.load()},
+                                   {"midiOutput", midiOutputModel.selectedItemId.load()},
+                                   {"surfaceAxis", surfaceAxis.load() + 1}
+                               }};
+        programState.addChild (curveEditorModel.toValueTree ("curveState"), -1, nullptr);
+        programState.addChild (upperCurveModel.toValueTree ("upperCurveState"), -1, nullptr);
+        ValueTree zonesState{"zones"};
+        for (const auto& zone : zones)
+            zonesState.addChild (zone->toValueTree(), -1, nullptr);
+        programState.addChild (zonesState, -1, nullptr);
+        return programState;
+    }
+
+    /**
+     * Bake a tree from createProgramState() into a snapshot, without touching the live curves, or adopt the tables
+     * saved for it by createBakedTables() if they are given and usable.
+     */
+    std::unique_ptr<aas::ProgramSnapshot> bakeProgram(const ValueTree& programState, const XmlElement* bakedTables = nullptr) const {
+        auto program = std::make_unique<aas::ProgramSnapshot>();
+        program->name = programState.getProperty ("name").toString();
+        program->state = programState.createCopy();
+        program->midiInputId = sanitiseDropdownId (programState.getProperty ("midiInput"), true);
+        program->midiOutputId = sanitiseDropdownId (programState.getProperty ("midiOutput"));
+        program->surfaceAxis = sanitiseSurfaceAxis (programState.getProperty ("surfaceAxis"));
+
+        const auto zoneList = readZones (programState.getChildWithName ("zones"));
+        aas::CurveEditorModel<float> low (curveEditorModel.minX, curveEditorModel.maxX, curveEditorModel.minY, curveEditorModel.maxY);
+        low.fromValueTree (programState.getChildWithName ("curveState"));
+        if (bakedTables != nullptr && program->adoptTables (*bakedTables, low, zoneList))
+            return program;
+
+        aas::CurveEditorModel<float> high (curveEditorModel.minX, curveEditorModel.maxX, curveEditorModel.minY, curveEditorModel.maxY);
+        high.fromValueTree (programState.getChildWithName ("upperCurveState"));
+        program->bake (low, high, zoneList);
+        return program;
+    }
+
+    /** Load a program's state into the live curves, zones and routing, for the editor. Message thread only. */
+    void loadProgramState(const ValueTree& programState) {
+        curveEditorModel.fromValueTree (programState.getChildWithName ("curveState"));
+        upperCurveModel.fromValueTree (programState.getChildWithName ("upperCurveState"));
+        bakeSurface();
+        replaceZones (readZones (programState.getChildWithName ("zones")));
+
+        setRouting (programState.getProperty ("midiInput"), programState.getProperty ("midiOutput"));
+        surfaceAxis = sanitiseSurfaceAxis (programState.getProperty ("surfaceAxis"));
+    }
+
+    /** Put a snapshot in a slot (or empty it), freeing the old one outside the audio lock. */
+    void setProgram(int index, std::unique_ptr<aas::ProgramSnapshot> program) {
+        {
+            const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+            std::swap (programs[(size_t) index], program);
+        }
+    }
+
+    /** The program the audio thread should play, or nullptr for the live curve. Call with curveEditorModel.lock held. */
+    const aas::ProgramSnapshot* getActiveProgram() const noexcept {
+        const int program = currentProgram;
+        return program >= 0 ? programs[(size_t) program].get() : nullptr;
+    }
+
+    void writeCurveState(const Identifier& name, const aas::CurveEditorModel<float>& model) {
+        // Reset the nodes within the state and then re-add them, without undo, as this only runs when saving
+        auto curveState = state.getOrCreateChildWithName (name, nullptr);
+        curveState.removeAllChildren (nullptr);
+        for (const auto& node : model.toValueTree (name))
+            curveState.addChild (node.createCopy(), -1, nullptr);
+    }
+
+    /**
+     * Run the sidechain through the envelope follower and the curve, and add the result to the block's MIDI.
+     */
+    template <typename Element>
+    void transformSidechain(const AudioBuffer<Element>& sidechain, MidiBuffer& midi) {
+        const SpinLock::ScopedLockType sl (curveEditorModel.lock);
+        const auto* program = getActiveProgram();
+        if ((program != nullptr ? program->midiInputId : midiInputModel.selectedItemId.load()) != Editor::SIDECHAIN_DROPDOWN_ID)
+            return;
+        const int CC_OUT = (program != nullptr ? program->midiOutputId : midiOutputModel.selectedItemId.load()) - 1;
+        const auto& model = curveEditorModel;
+        const int numMidiControlPoints = numControlPoints;
+        bool addedControlPoints = false;
+
+        envelopeFollower.process (sidechain, [&](int samplePosition, double level)
+        {
+            const auto inputValue = static_cast<float> (model.minX + level * (model.maxX - model.minX));
+            const auto outputValue = program != nullptr ? program->compute (inputValue) : curveEditorModel.compute (inputValue);
+            curveEditorModel.lastInput = inputValue;
+
+            const auto controlValue = (outputValue - model.minY) / (model.maxY - model.minY);
+            addControlPoint (samplePosition, controlValue);
+            addedControlPoints = true;
+
+            // Velocity output picks the value up from lastInput on the next note on
+            int outputInt = -1;
+            MidiMessage newMsg;
+            if (CC_OUT >= 0) {
+                outputInt = jlimit (0, 127, static_cast<int> (outputValue));
+                newMsg = MidiMessage::controllerEvent (1, CC_OUT, outputInt);
+            }
+            else if (CC_OUT == Editor::PITCH_DROPDOWN_ID - 1) {
+                outputInt = jlimit (0, (1 << 14) - 1, static_cast<int> (controlValue * (1 << 14)));
+                newMsg = MidiMessage::pitchWheel (1, outputInt);
+            }
+
+            if (outputInt >= 0 && outputInt != lastSidechainOutput) {
+                lastSidechainOutput = outputInt;
+                midi.addEvent (newMsg, samplePosition);
+            }
+        });
+
+        // The MIDI's points and the sidechain's are each in sample order, but the renderer needs them in one order
+        if (addedControlPoints && numMidiControlPoints > 0)
+            sortControlPoints();
+    }
+
+    /** Keep a transformed value for the control signal. A denser burst than there is room for replaces the newest. */
+    void addControlPoint(int samplePosition, float value) noexcept {
+        if (numControlPoints < static_cast<int> (controlPoints.size()))
+            numControlPoints++;
+        else
+            editorStats.droppedControlPoints.fetch_add (1, std::memory_order_relaxed);
+        controlPoints[static_cast<size_t> (numControlPoints - 1)] = {samplePosition, value};
+    }
+
+    /**
+     * Put the block's control points in sample order, keeping the order of points at the same position. An insertion
+     * sort, which allocates nothing and costs little on two runs that are each already in order.
+     */
+    void sortControlPoints() noexcept {
+        const auto begin = controlPoints.begin();
+        const auto end = begin + numControlPoints;
+        auto earlier = [](const aas::ControlSignalRenderer::Point& a, const aas::ControlSignalRenderer::Point& b) { return a.samplePosition < b.samplePosition; };
+        for (auto it = begin + 1; it < end; ++it)
+            std::rotate (std::upper_bound (begin, it, *it, earlier), it, it + 1);
+    }
+
+    void setThinningTolerance(float tolerance) {
+        decimator.setTolerance (tolerance);
+        updateLatency();
+    }
+
+    /** The decimator delays everything it sees, so report that while it is on. */
+    void updateLatency() {
+        setLatencySamples (getThinningLatency());
+    }
+
+    int getThinningLatency() const noexcept {
+        return decimator.getTolerance() > 0.0f ? decimator.getLatencySamples() : 0;
+    }
+
+    void updateEnvelopeFollower() {
+        envelopeFollower.setMode (static_cast<int> (uiState.getProperty ("envelopeMode")) == 1 + static_cast<int> (aas::EnvelopeFollower::Mode::Rms)
+                                      ? aas::EnvelopeFollower::Mode::Rms
+                                      : aas::EnvelopeFollower::Mode::Peak);
+        envelopeFollower.setAttackMs (uiState.getProperty ("envelopeAttack"));
+        envelopeFollower.setReleaseMs (uiState.getProperty ("envelopeRelease"));
+        envelopeFollower.setRateHz (uiState.getProperty ("envelopeRate"));
+    }
+
+    void addDefaultUiState() {
+        const std::initializer_list<NamedValueSet::NamedValue> defaults{
+            {"width", 500},
+            {"height", 400},
+            {"midiInput", 1},
+            {"midiOutput", 1},
+            {"controlOutput", false},
+            {"dinLimit", false},
+            {"thinTolerance", 0.0},
+            {"envelopeMode", 1},
+            {"envelopeAttack", 10.0},
+            {"envelopeRelease", 150.0},
+            {"envelopeRate", 100.0},
+            {"surfaceAxis", 1},
+            {"performanceOverlay", false},
+            {"embedTables", true}
+        };
+        for (const auto& property : defaults)
+            if (!uiState.hasProperty (property.name))
+                uiState.setProperty (property.name, property.value, nullptr);
+    }
+
+    /** Bring the settings the audio thread reads from atomics back into the view state, for saving. */
+    void storeUiState() {
+        uiState.setProperty ("midiInput", midiInputModel.selectedItemId.load(), nullptr);
+        uiState.setProperty ("midiOutput", midiOutputModel.selectedItemId.load(), nullptr);
+        uiState.setProperty ("controlOutput", controlOutputEnabled.load(), nullptr);
+        uiState.setProperty ("dinLimit", dinLimitEnabled.load(), nullptr);
+        uiState.setProperty ("surfaceAxis", surfaceAxis.load() + 1, nullptr);
+    }
+
+    /** Map any id the dropdowns could not have produced back onto the default (CC 0). */
+    static int sanitiseDropdownId(const var& id, bool isInput = false) {
+        const int itemId = id;
+        const int lowestId = isInput ? Editor::SIDECHAIN_DROPDOWN_ID : Editor::PITCH_DROPDOWN_ID;
+        return (itemId >= lowestId && itemId <= 128 && itemId != 0) ? itemId : 1;
     }
 
     static BusesProperties getBusesLayout() {
         // Live doesn't like to load midi-only plugins, so we add an audio output there.
+        // The sidechain is off by default so that hosts which only want MIDI are not asked for audio.
         return PluginHostType().isAbletonLive()
-                   ? BusesProperties().withOutput ("out", AudioChannelSet::stereo())
-                   : BusesProperties();
+                   ? BusesProperties().withInput ("Sidechain", AudioChannelSet::stereo(), false).withOutput ("out", AudioChannelSet::stereo())
+                   : BusesProperties().withInput ("Sidechain", AudioChannelSet::stereo(), false);
     }
 
     ValueTree state{"state"};
     UndoManager undoManager;
+    // The editor's size and settings. Kept out of the document and its undo history, and only added to the saved state
+    // by getStateInformation(), so that resizing or changing a setting costs no history and reaches no listeners of
+    // the document.
+    ValueTree uiState{"uiState"};
     MidiQueue queue;
+    // Reused by drainTelemetry(), so that draining doesn't allocate once the vector has grown
+    std::vector<MidiMessage> drainedMessages;
+    aas::MidiCapture capture;
+    // Running sample count, used to timestamp captured events
+    int64 samplesProcessed = 0;
     // The data to show in the UI. We keep it around in the processor so that the view is persistent even when the plugin UI is closed and reopened.
     DropdownListModel midiOutputModel;
     DropdownListModel midiInputModel;
     aas::CurveEditorModel<float> curveEditorModel;
+    // The curve at the top of the second axis, when the transform is a surface
+    aas::CurveEditorModel<float> upperCurveModel;
+
+    // The baked surface: the copy that the audio thread reads under curveEditorModel.lock, and the UI's copy of it,
+    // which the timer updates whenever surfaceBakes moves on
+    aas::TransformSurface surface;
+    aas::TransformSurface audioSurface;
+    std::atomic<int> surfaceBakes{0};
+    std::atomic<int> surfaceAxis{SurfaceAxisOff};
+
+    // Keyboard zones, edited on the message thread, and the baked copy the audio thread reads under curveEditorModel.lock
+    std::vector<std::unique_ptr<aas::KeyboardZone>> zones;
+    aas::ZoneMap audioZones;
+    // The second axis and the sounding notes, per channel, on the audio thread
+    ChannelState channelState;
+
+    // The program bank. Slots are filled and emptied on the message thread under curveEditorModel.lock; the audio
+    // thread switches between them by changing currentProgram alone. -1 means the live curve, e.g. after an edit.
+    static constexpr int numPrograms = 128;
+    std::array<std::unique_ptr<aas::ProgramSnapshot>, numPrograms> programs;
+    std::atomic<int> currentProgram{-1};
+    // The program last loaded into the editable state, on the message thread
+    int loadedProgram = -1;
+
+    std::atomic<bool> controlOutputEnabled{false};
+    aas::ControlSignalRenderer controlSignal;
+    aas::EnvelopeFollower envelopeFollower;
+    std::atomic<bool> dinLimitEnabled{false};
+    // Measured by the editor's curve views and the telemetry drain while the editor shows its performance overlay,
+    // and by the audio thread's control points at all times
+    aas::PerformanceStats editorStats;
+    aas::MidiRateLimiter rateLimiter;
+    aas::StreamDecimator decimator;
+    // Last value sent from the sidechain, so that an unchanged level sends nothing
+    int lastSidechainOutput = -1;
+    // The block's output while transformMidi() builds it, sized by prepareToPlay()
+    MidiBuffer transformedMidi;
+    // A 3-byte message and its position and size, as MidiBuffer stores them
+    static constexpr size_t transformedBytesPerSample = 9;
+    // Transformed values of the current block, in sample order, for the control signal
+    std::array<aas::ControlSignalRenderer::Point, 512> controlPoints{};
+    int numControlPoints = 0;
+
+    // Declared last, so that it is destroyed (cancelling this instance's jobs) before anything they use
+    aas::BackgroundWorker::Client worker;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiTransformerPluginProcessor)
 };
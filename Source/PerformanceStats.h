@@ -0,0 +1,158 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace aas
+{
+    /**
+     * The most recent values of one measurement, e.g. how long each paint took.
+     *
+     * One thread at a time adds values and any thread may read them. A reader that races a writer can see a value
+     * from the previous lap of the ring, which doesn't matter for the statistics taken from it.
+     */
+    class MeasurementHistory {
+    public:
+        static constexpr int size = 256;
+
+        struct Summary {
+            int count = 0;
+            float median = 0.0f, p90 = 0.0f, p99 = 0.0f, max = 0.0f;
+        };
+
+        void add(float value) noexcept {
+            const int index = next.load (std::memory_order_relaxed);
+            values[(size_t) index].store (value, std::memory_order_relaxed);
+            next.store ((index + 1) % size, std::memory_order_relaxed);
+            count.store (jmin (count.load (std::memory_order_relaxed) + 1, size), std::memory_order_release);
+        }
+
+        /** Percentiles of the values in the ring. Sorts a copy, so meant for a few calls per second. */
+        Summary getSummary() const noexcept {
+            std::array<float, size> sorted;
+            const int numValues = count.load (std::memory_order_acquire);
+            for (int i = 0; i < numValues; i++)
+                sorted[(size_t) i] = values[(size_t) i].load (std::memory_order_relaxed);
+            std::sort (sorted.begin(), sorted.begin() + numValues);
+
+            Summary summary;
+            summary.count = numValues;
+            if (numValues > 0) {
+                auto percentile = [&](float p) { return sorted[(size_t) roundToInt (p * static_cast<float> (numValues - 1))]; };
+                summary.median = percentile (0.5f);
+                summary.p90 = percentile (0.9f);
+                summary.p99 = percentile (0.99f);
+                summary.max = sorted[(size_t) numValues - 1];
+            }
+            return summary;
+        }
+
+    private:
+        std::array<std::atomic<float>, size> values{};
+        std::atomic<int> next{0};
+        std::atomic<int> count{0};
+    };
+
+    /**
+     * What the editor's performance overlay shows. Owned by the processor, since the telemetry drain it measures runs
+     * on the background worker and may outlive the editor.
+     */
+    struct PerformanceStats {
+        /** Nothing is measured while this is false, so the timers cost nothing until the overlay is shown */
+        std::atomic<bool> enabled{false};
+        /** Duration of each curve editor paint, in ms (message thread) */
+        MeasurementHistory paintMs;
+        std::atomic<int> numPaints{0};
+        /** Duration of each telemetry drain, in ms, and how many events it took off the queue (background worker) */
+        MeasurementHistory drainMs;
+        MeasurementHistory eventsDrained;
+        /** Values the control signal had no room for, in their block or its delay (audio thread, counted even when off) */
+        std::atomic<int64> droppedControlPoints{0};
+    };
+
+    /**
+     * Adds the time from its construction to its destruction to a history, in ms, unless the history is nullptr.
+     */
+    class ScopedMeasurement {
+    public:
+        explicit ScopedMeasurement(MeasurementHistory* historyIn) noexcept :
+            history (historyIn),
+            startTicks (history != nullptr ? Time::getHighResolutionTicks() : 0) { }
+
+        ~ScopedMeasurement() {
+            if (history != nullptr)
+                history->add (static_cast<float> (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks) * 1000.0));
+        }
+
+    private:
+        MeasurementHistory* history;
+        int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedMeasurement)
+    };
+
+    /**
+     * A small read-out of PerformanceStats, drawn over the editor. Measuring is switched on while the overlay is
+     * visible and off again when it is hidden.
+     *
+     * The text is refreshed a few times per second. Each refresh also repaints whatever is beneath the overlay, so
+     * the repaint rate it shows includes those few repaints of its own.
+     */
+    class PerformanceOverlay : public juce::Component,
+                               private Timer {
+    public:
+        static constexpr int refreshRateHz = 4;
+
+        explicit PerformanceOverlay(PerformanceStats& stats) :
+            stats (stats) {
+            setInterceptsMouseClicks (false, false);
+        }
+
+        ~PerformanceOverlay() override {
+            stats.enabled = false;
+        }
+
+        void paint(Graphics& g) override {
+            g.setColour (Colours::black.withAlpha (0.7f));
+            g.fillRoundedRectangle (getLocalBounds().toFloat(), 4.0f);
+            g.setColour (Colours::lightgreen);
+            g.setFont (Font (Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+            g.drawFittedText (text, getLocalBounds().reduced (6, 4), Justification::topLeft, 5);
+        }
+
+        void visibilityChanged() override {
+            stats.enabled = isVisible();
+            if (isVisible()) {
+                lastPaints = stats.numPaints;
+                lastRefresh = Time::getMillisecondCounterHiRes();
+                startTimerHz (refreshRateHz);
+            }
+            else {
+                stopTimer();
+            }
+        }
+
+    private:
+        void timerCallback() override {
+            const double now = Time::getMillisecondCounterHiRes();
+            const int paints = stats.numPaints;
+            const double paintsPerSecond = (paints - lastPaints) * 1000.0 / jmax (1.0, now - lastRefresh);
+            lastPaints = paints;
+            lastRefresh = now;
+
+            const auto paint = stats.paintMs.getSummary();
+            const auto drain = stats.drainMs.getSummary();
+            const auto events = stats.eventsDrained.getSummary();
+            text = "paint ms  p50 " + String (paint.median, 2) + "  p90 " + String (paint.p90, 2) + "  p99 " + String (paint.p99, 2)
+                   + "  max " + String (paint.max, 2) + "\n"
+                   + "repaints/s " + String (paintsPerSecond, 1) + "\n"
+                   + "drain ms  p50 " + String (drain.median, 3) + "  p99 " + String (drain.p99, 3) + "  max " + String (drain.max, 3) + "\n"
+                   + "events/tick  p50 " + String (roundToInt (events.median)) + "  max " + String (roundToInt (events.max)) + "\n"
+                   + "control points dropped " + String (stats.droppedControlPoints.load());
+            repaint();
+        }
+
+        PerformanceStats& stats;
+        String text;
+        int lastPaints = 0;
+        double lastRefresh = 0.0;
+    };
+}
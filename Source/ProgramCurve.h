@@ -0,0 +1,62 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AdaptiveCurveTable.h"
+#include "CurveFunction.h"
+
+namespace aas
+{
+    /**
+     * A program's curve, as the audio thread plays it.
+     *
+     * Controllers and velocities reach the curve as whole numbers, and those 128 inputs read the curve's exact
+     * output from a table, so a program maps them exactly as the live curve does. Inputs between them (pitch bend,
+     * the sidechain) read an AdaptiveCurveTable, so every lookup costs the same whatever the curve. A curve the table
+     * can't follow within its bound, such as a stepped bezier, keeps the finest table the baker reached, and
+     * meetsMaxError() and the table's getAchievedError() report how far it strays.
+     *
+     * Never changed after bake() or adopt(), so it can be read from any thread. Assumes the plugin's 0-127 input range.
+     */
+    class ProgramCurve {
+    public:
+        static constexpr int numWholeInputs = 128;
+        using WholeInputValues = std::array<float, numWholeInputs>;
+
+        ProgramCurve() :
+            exact (0.0f, 127.0f, 0.0f, 127.0f) { }
+
+        /** \return false if the table missed maxError somewhere, though it is still used */
+        bool bake(CurveFunction<float> curve, float maxError = AdaptiveCurveTable::defaultMaxError) {
+            exact = std::move (curve);
+            for (int i = 0; i < numWholeInputs; i++)
+                wholeInputValues[(size_t) i] = exact.compute (static_cast<float> (i));
+            return table.bake (exact.minX, exact.maxX, maxError, [this](float input) { return exact.compute (input); });
+        }
+
+        /** Take tables saved from an earlier bake() of the same curve instead of baking them again */
+        void adopt(CurveFunction<float> curve, const WholeInputValues& values, AdaptiveCurveTable bakedTable) {
+            exact = std::move (curve);
+            wholeInputValues = values;
+            table = std::move (bakedTable);
+        }
+
+        float compute(float input) const noexcept {
+            if (input >= 0.0f && input < static_cast<float> (numWholeInputs)) {
+                const auto index = static_cast<int> (input);
+                if (static_cast<float> (index) == input)
+                    return wholeInputValues[(size_t) index];
+            }
+            return table.compute (input);
+        }
+
+        const CurveFunction<float>& getCurve() const noexcept { return exact; }
+        const WholeInputValues& getWholeInputValues() const noexcept { return wholeInputValues; }
+        const AdaptiveCurveTable& getTable() const noexcept { return table; }
+        /** false if the table strays further from the curve than the bound it was baked to */
+        bool meetsMaxError() const noexcept { return table.meetsMaxError(); }
+
+    private:
+        CurveFunction<float> exact;
+        WholeInputValues wholeInputValues{};
+        AdaptiveCurveTable table;
+    };
+}
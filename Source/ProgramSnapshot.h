@@ -0,0 +1,91 @@
+#pragma once
+#include "BakedTables.h"
+#include "KeyboardZones.h"
+#include "ProgramCurve.h"
+#include "TransformSurface.h"
+
+namespace aas
+{
+    /**
+     * One program of the bank: a curve, surface, zones and routing, all baked ahead of time.
+     *
+     * Switching programs on the audio thread only changes which snapshot it reads, so nothing is evaluated, parsed
+     * or allocated at switch time. The editable state the snapshot was baked from is kept alongside it, to be loaded
+     * back into the editor and saved with the plugin.
+     */
+    struct ProgramSnapshot {
+        /**
+         * Bake the low curve into a ProgramCurve, with its table within maxError of it where it can be, the surface
+         * from both curves, and the zones.
+         */
+        void bake(CurveEditorModel<float>& low, CurveEditorModel<float>& high, const std::vector<std::unique_ptr<KeyboardZone>>& zoneList,
+                  float maxError = AdaptiveCurveTable::defaultMaxError) {
+            curve.bake (toCurveFunction (low), maxError);
+            surface.bake (low, high);
+            zones.bake (zoneList);
+        }
+
+        /**
+         * Take the tables saved by writeTables() instead of baking them, leaving only the zone routing to be worked out.
+         * low is the curve they were baked from, kept for the inputs the table can't serve.
+         * \return false, with nothing changed, if any of them is missing or damaged.
+         */
+        bool adoptTables(const XmlElement& tables, const CurveEditorModel<float>& low, const std::vector<std::unique_ptr<KeyboardZone>>& zoneList) {
+            AdaptiveCurveTable::SegmentCounts bakedCounts;
+            std::vector<float> bakedSamples;
+            ProgramCurve::WholeInputValues bakedValues;
+            TransformSurface::Values bakedSurface;
+            ZoneMap::VelocityTables bakedVelocities;
+            if (!BakedTables::read (tables, "curveCells", bakedCounts) || !BakedTables::read (tables, "curveSamples", bakedSamples)
+                || !BakedTables::read (tables, "curveValues", bakedValues) || !BakedTables::read (tables, "surface", bakedSurface)
+                || !BakedTables::read (tables, "zones", bakedVelocities))
+                return false;
+
+            AdaptiveCurveTable bakedCurve;
+            if (!bakedCurve.adopt (low.minX, low.maxX, bakedCounts, std::move (bakedSamples), static_cast<float> (tables.getDoubleAttribute ("curveMaxError")),
+                                   static_cast<float> (tables.getDoubleAttribute ("curveError"))))
+                return false;
+
+            curve.adopt (toCurveFunction (low), bakedValues, std::move (bakedCurve));
+            surface.adopt (bakedSurface);
+            zones.bake (zoneList, &bakedVelocities);
+            return true;
+        }
+
+        void writeTables(XmlElement& tables) const {
+            const auto& table = curve.getTable();
+            BakedTables::write (tables, "curveCells", table.getSegmentCounts());
+            BakedTables::write (tables, "curveSamples", table.getSamples());
+            BakedTables::write (tables, "curveValues", curve.getWholeInputValues());
+            tables.setAttribute ("curveMaxError", table.getMaxError());
+            tables.setAttribute ("curveError", table.getAchievedError());
+            BakedTables::write (tables, "surface", surface.values);
+            BakedTables::write (tables, "zones", zones.velocityTables);
+        }
+
+        /** The model's nodes as a CurveFunction, which evaluates them identically and can be read from any thread */
+        static CurveFunction<float> toCurveFunction(const CurveEditorModel<float>& model) {
+            CurveFunction<float> function (model.minX, model.maxX, model.minY, model.maxY);
+            for (const auto& node : model.nodes)
+                function.nodes.push_back ({{node->anchor.pt.x, node->anchor.pt.y},
+                                           {node->control1.pt.x, node->control1.pt.y},
+                                           {node->control2.pt.x, node->control2.pt.y},
+                                           node->curveType});
+            return function;
+        }
+
+        float compute(float input) const noexcept { return curve.compute (input); }
+
+        String name;
+        /** The tree the snapshot was baked from (see MidiTransformerPluginProcessor::createProgramState) */
+        ValueTree state;
+
+        int midiInputId = 1;
+        int midiOutputId = 1;
+        int surfaceAxis = 0;
+
+        ProgramCurve curve;
+        TransformSurface surface;
+        ZoneMap zones;
+    };
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include "MidiRateLimiter.h"
+
+namespace aas
+{
+    /**
+     * Drops the controller and pitch bend events that a straight line between their neighbours already reproduces
+     * to within a tolerance, so a smooth sweep is sent as a handful of corner points instead of every step.
+     *
+     * Every event goes through a fixed delay of windowSeconds, which is reported to the host as latency, and each
+     * stream (one per channel and controller, plus pitch bend) is fitted while its events wait. The fit is the
+     * streaming "swing door" form of piecewise-linear simplification: the stream keeps the range of slopes from its
+     * last kept point that pass within the tolerance of every point since. While the slope to a new point stays
+     * within that range, the previous point is dropped, since the line to the new point, which is what the receiver
+     * rebuilds, passes near every point in between. Otherwise the previous point is kept and becomes the start of the
+     * next segment. A point that reaches the end of the delay still undecided is kept, so the added latency never
+     * exceeds the window and a stream always ends on its last value.
+     *
+     * Switch-like controllers (see MidiRateLimiter::isSwitchController) and every other short message are delayed but
+     * never dropped, so their order relative to the notes is unchanged. Waiting events are kept as raw bytes, so the
+     * audio thread never allocates for them; SysEx and anything else longer than three bytes passes straight through
+     * without the delay.
+     */
+    class StreamDecimator {
+    public:
+        static constexpr double windowSeconds = 0.02;
+
+        StreamDecimator() {
+            reset();
+        }
+
+        void prepare(double sampleRate, int maximumBlockSize) {
+            windowSamples = jmax (1, roundToInt (sampleRate * windowSeconds));
+            output.ensureSize (static_cast<size_t> (jmax (maximumBlockSize, capacity)) * 4);
+            reset();
+        }
+
+        void reset() noexcept {
+            head = tail = 0;
+            time = 0;
+            for (auto& stream : streams)
+                stream = Stream();
+        }
+
+        int getLatencySamples() const noexcept { return windowSamples; }
+
+        /** Maximum distance, in 7-bit steps, between the sent and the original stream. 0 switches decimation off. */
+        void setTolerance(float newTolerance) noexcept { tolerance = jmax (0.0f, newTolerance); }
+        float getTolerance() const noexcept { return tolerance; }
+
+        /**
+         * Decimate a block. The output is the input of windowSamples ago, minus the events that were dropped.
+         */
+        void process(MidiBuffer& midi, int numSamples) {
+            const float currentTolerance = tolerance;
+            if (currentTolerance <= 0.0f) {
+                if (head != tail)
+                    release (midi);
+                return;
+            }
+
+            output.clear();
+            for (const auto metadata : midi) {
+                if (metadata.numBytes > maxEventBytes) {
+                    output.addEvent (metadata.data, metadata.numBytes, metadata.samplePosition);
+                    continue;
+                }
+                if (tail - head == capacity)
+                    emit (0);
+
+                const int64 eventTime = time + metadata.samplePosition;
+                const int64 sequence = tail++;
+                auto& event = events[(size_t) (sequence % capacity)];
+                std::copy (metadata.data, metadata.data + metadata.numBytes, event.bytes.begin());
+                event.size = static_cast<uint8> (metadata.numBytes);
+                event.due = eventTime + windowSamples;
+                event.dropped = false;
+                event.stream = getStream (event.bytes.data(), metadata.numBytes);
+                if (event.stream >= 0) {
+                    const bool isPitchWheel = (event.bytes[0] & 0xf0) == 0xe0;
+                    const int value = isPitchWheel ? event.bytes[1] | (event.bytes[2] << 7) : event.bytes[2];
+                    const float streamTolerance = isPitchWheel ? currentTolerance * 128.0f : currentTolerance;
+                    addPoint (streams[(size_t) event.stream], sequence, eventTime, static_cast<float> (value), streamTolerance);
+                }
+            }
+
+            while (head != tail && events[(size_t) (head % capacity)].due < time + numSamples)
+                emit (static_cast<int> (jmax ((int64) 0, events[(size_t) (head % capacity)].due - time)));
+
+            time += numSamples;
+            midi.swapWith (output);
+        }
+
+    private:
+        static constexpr int maxEventBytes = 3;
+
+        struct Event {
+            std::array<uint8, maxEventBytes> bytes{};
+            uint8 size = 0;
+            int64 due = 0;
+            int stream = -1;
+            bool dropped = false;
+        };
+
+        struct Stream {
+            bool hasAnchor = false;
+            int64 anchorTime = 0;
+            float anchorValue = 0.0f;
+            /** Sequence number of the last point, which is dropped or kept once the next one arrives, or -1 */
+            int64 candidate = -1;
+            int64 candidateTime = 0;
+            float candidateValue = 0.0f;
+            float minSlope = 0.0f, maxSlope = 0.0f;
+        };
+
+        static constexpr int capacity = 4096;
+        static constexpr int streamsPerChannel = 128 + 1;
+
+        /** The stream a controller or pitch bend belongs to, or -1 */
+        static int getStream(const uint8* bytes, int numBytes) noexcept {
+            if (numBytes < 3)
+                return -1;
+            const int channelIndex = bytes[0] & 0x0f;
+            const int controllerNumber = bytes[1] & 0x7f;
+            if ((bytes[0] & 0xf0) == 0xb0 && !MidiRateLimiter::isSwitchController (controllerNumber))
+                return channelIndex * streamsPerChannel + controllerNumber;
+            if ((bytes[0] & 0xf0) == 0xe0)
+                return channelIndex * streamsPerChannel + 128;
+            return -1;
+        }
+
+        void addPoint(Stream& stream, int64 sequence, int64 pointTime, float value, float pointTolerance) noexcept {
+            if (stream.hasAnchor && stream.candidate >= 0) {
+                const auto dt = static_cast<float> (pointTime - stream.anchorTime);
+                const float maxSlope = jmin (stream.maxSlope, (value + pointTolerance - stream.anchorValue) / dt);
+                const float minSlope = jmax (stream.minSlope, (value - pointTolerance - stream.anchorValue) / dt);
+                const float slope = (value - stream.anchorValue) / dt;
+                if (minSlope <= slope && slope <= maxSlope) {
+                    // The line from the anchor to this point passes near every point since, so the previous one isn't needed
+                    events[(size_t) (stream.candidate % capacity)].dropped = true;
+                    setCandidate (stream, sequence, pointTime, value);
+                    stream.minSlope = minSlope;
+                    stream.maxSlope = maxSlope;
+                    return;
+                }
+
+                // Keep the previous point and start the next segment from it
+                stream.anchorTime = stream.candidateTime;
+                stream.anchorValue = stream.candidateValue;
+                stream.candidate = -1;
+            }
+
+            if (!stream.hasAnchor || pointTime == stream.anchorTime) {
+                // Nothing to fit against yet
+                stream.hasAnchor = true;
+                stream.anchorTime = pointTime;
+                stream.anchorValue = value;
+                stream.candidate = -1;
+                return;
+            }
+
+            const auto dt = static_cast<float> (pointTime - stream.anchorTime);
+            setCandidate (stream, sequence, pointTime, value);
+            stream.maxSlope = (value + pointTolerance - stream.anchorValue) / dt;
+            stream.minSlope = (value - pointTolerance - stream.anchorValue) / dt;
+        }
+
+        static void setCandidate(Stream& stream, int64 sequence, int64 pointTime, float value) noexcept {
+            stream.candidate = sequence;
+            stream.candidateTime = pointTime;
+            stream.candidateValue = value;
+        }
+
+        /** Send the oldest event at the given position, unless it was dropped. */
+        void emit(int position) {
+            const int64 sequence = head++;
+            auto& event = events[(size_t) (sequence % capacity)];
+            if (event.dropped)
+                return;
+
+            // An undecided point that reaches the end of the window is kept
+            if (event.stream >= 0) {
+                auto& stream = streams[(size_t) event.stream];
+                if (stream.candidate == sequence) {
+                    stream.anchorTime = stream.candidateTime;
+                    stream.anchorValue = stream.candidateValue;
+                    stream.candidate = -1;
+                }
+            }
+            output.addEvent (event.bytes.data(), event.size, position);
+        }
+
+        /** Send everything still waiting at the start of the block, ahead of the block's own events. */
+        void release(MidiBuffer& midi) {
+            output.clear();
+            while (head != tail)
+                emit (0);
+            output.addEvents (midi, 0, -1, 0);
+            midi.swapWith (output);
+            reset();
+        }
+
+        std::atomic<float> tolerance{0.0f};
+        int windowSamples = roundToInt (44100.0 * windowSeconds);
+        // Running sample count at the start of the current block
+        int64 time = 0;
+
+        std::vector<Event> events = std::vector<Event> (capacity);
+        int64 head = 0, tail = 0;
+        std::array<Stream, 16 * streamsPerChannel> streams;
+
+        MidiBuffer output;
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "CurveEditor.h"
+
+namespace aas
+{
+    /**
+     * A two-dimensional transform (e.g. velocity x note, or CC x CC) baked into a 128x128 table of 7-bit outputs.
+     *
+     * The surface blends between two curves: the low curve applies when the second axis is at 0 and the high curve
+     * when it is at 127. Baking evaluates each curve only 128 times, and the audio thread only ever does a bilinear
+     * lookup into the 16 KB table.
+     */
+    struct TransformSurface {
+        static constexpr int size = 128;
+        /** One curve sampled at every 7-bit input, scaled to 0..127 */
+        using Row = std::array<float, size>;
+        using Values = std::array<uint8, size * size>;
+
+        template <typename T>
+        void bake(CurveEditorModel<T>& low, CurveEditorModel<T>& high) {
+            Row lowRow, highRow;
+            sampleCurve (low, lowRow);
+            sampleCurve (high, highRow);
+            bake (lowRow, highRow);
+        }
+
+        /**
+         * Sample a curve for bake(). This is the only part that evaluates the curve, so a caller on another thread
+         * only needs to hold the curve's lock for this.
+         */
+        template <typename T>
+        static void sampleCurve(CurveEditorModel<T>& model, Row& row) {
+            for (int x = 0; x < size; x++) {
+                const T input = model.minX + (model.maxX - model.minX) * static_cast<T> (x) / static_cast<T> (size - 1);
+                row[(size_t) x] = static_cast<float> ((model.compute (input) - model.minY) / (model.maxY - model.minY)) * (size - 1);
+            }
+        }
+
+        void bake(const Row& lowRow, const Row& highRow) {
+            for (int y = 0; y < size; y++) {
+                const float amount = static_cast<float> (y) / static_cast<float> (size - 1);
+                for (int x = 0; x < size; x++) {
+                    const float value = lowRow[(size_t) x] + amount * (highRow[(size_t) x] - lowRow[(size_t) x]);
+                    values[(size_t) (y * size + x)] = static_cast<uint8> (jlimit (0, size - 1, roundToInt (value)));
+                }
+            }
+            version++;
+        }
+
+        /** Take a table baked earlier (see BakedTables.h) instead of baking it again */
+        void adopt(const Values& bakedValues) {
+            values = bakedValues;
+            version++;
+        }
+
+        uint8 at(int x, int y) const noexcept { return values[(size_t) (y * size + x)]; }
+
+        /**
+         * Bilinear lookup. Both coordinates are in 0..127 and the result is too.
+         */
+        float lookup(float x, float y) const noexcept {
+            x = jlimit (0.0f, static_cast<float> (size - 1), x);
+            y = jlimit (0.0f, static_cast<float> (size - 1), y);
+            const int x0 = jmin (static_cast<int> (x), size - 2);
+            const int y0 = jmin (static_cast<int> (y), size - 2);
+            const float fx = x - static_cast<float> (x0);
+            const float fy = y - static_cast<float> (y0);
+
+            const float bottom = at (x0, y0) + fx * (at (x0 + 1, y0) - at (x0, y0));
+            const float top = at (x0, y0 + 1) + fx * (at (x0 + 1, y0 + 1) - at (x0, y0 + 1));
+            return bottom + fy * (top - bottom);
+        }
+
+        Values values{};
+        /** Incremented on every bake, so views know when to redraw */
+        int version = 0;
+    };
+
+    /**
+     * Shows a baked TransformSurface as a heat map: input along X, the second axis along Y, output as colour.
+     *
+     * The image is built straight from the table rather than by evaluating the curves again.
+     */
+    class SurfaceView : public juce::Component {
+    public:
+        explicit SurfaceView(const TransformSurface& surface) :
+            surface (surface) { }
+
+        void paint(Graphics& g) override {
+            if (imageVersion != surface.version || !image.isValid()) {
+                image = Image (Image::RGB, TransformSurface::size, TransformSurface::size, false);
+                Image::BitmapData pixels (image, Image::BitmapData::writeOnly);
+                for (int y = 0; y < TransformSurface::size; y++) {
+                    for (int x = 0; x < TransformSurface::size; x++) {
+                        const float level = surface.at (x, y) / static_cast<float> (TransformSurface::size - 1);
+                        // The second axis increases upwards, like the curve editor's Y axis
+                        pixels.setPixelColour (x, TransformSurface::size - 1 - y, Colour::fromHSV (0.7f * (1.0f - level), 0.8f, 0.2f + 0.8f * level, 1.0f));
+                    }
+                }
+                imageVersion = surface.version;
+            }
+
+            g.setImageResamplingQuality (Graphics::lowResamplingQuality);
+            g.drawImage (image, getLocalBounds().toFloat());
+        }
+
+    private:
+        const TransformSurface& surface;
+        Image image;
+        int imageVersion = -1;
+    };
+}
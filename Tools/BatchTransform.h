@@ -0,0 +1,183 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  BatchTransform
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Applies a MIDI-Transformer curve to a batch of MIDI files.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "OfflineTransform.h"
+
+/**
+ * Applies the curve saved in a capture log's state to every MIDI file given, the way the plugin would, and writes
+ * the results to an output folder under the same names.
+ *
+ * Usage: BatchTransform <capture.mtcap> <output folder> <file.mid>... [--exact] [--threads N] [--verify]
+ *
+ * A state that only needs the main curve (see ByteRemapTransform) has it baked into a 128-byte table: the values of
+ * every matching event are gathered into one packed array per file, and the array is remapped in one go with
+ * aas::remapBytes().
+ *
+ * Any other state, or any state with --exact, goes through the plugin's own transform instead, with everything the
+ * state holds, split across --threads threads (all cores by default) by a SegmentedTransform. Each track starts
+ * from the state as saved. --verify also transforms every track on one thread and counts the blocks that differ.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const bool exact = args.contains ("--exact");
+    const bool verify = args.contains ("--verify");
+    args.removeString ("--exact");
+    args.removeString ("--verify");
+    int numThreads = SystemStats::getNumCpus();
+    const int threadsIndex = args.indexOf ("--threads");
+    if (threadsIndex >= 0) {
+        numThreads = jmax (1, args[threadsIndex + 1].getIntValue());
+        args.removeRange (threadsIndex, 2);
+    }
+    if (args.size() < 3) {
+        std::cout << "Usage: BatchTransform <capture.mtcap> <output folder> <file.mid>... [--exact] [--threads N] [--verify]" << std::endl;
+        return 1;
+    }
+
+    aas::CapturedSession session;
+    const auto loadResult = session.load (File::getCurrentWorkingDirectory().getChildFile (args[0]));
+    if (loadResult.failed()) {
+        std::cerr << loadResult.getErrorMessage() << std::endl;
+        return 1;
+    }
+    const auto xml = AudioProcessor::getXmlFromBinary (session.state.getData(), static_cast<int> (session.state.getSize()));
+    if (xml == nullptr) {
+        std::cerr << "The capture log holds no plugin state" << std::endl;
+        return 1;
+    }
+    const auto state = ValueTree::fromXml (*xml);
+
+    const ByteRemapTransform remap (state);
+    const bool segmented = exact || !remap.isUsable();
+    std::unique_ptr<SegmentedTransform> transform;
+    if (segmented)
+        transform = std::make_unique<SegmentedTransform> (session.state, numThreads);
+
+    const auto outputFolder = File::getCurrentWorkingDirectory().getChildFile (args[1]);
+    if (outputFolder.createDirectory().failed()) {
+        std::cerr << "Cannot create " << outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    constexpr int blockSize = 1024;
+    aas::ByteRemapBatch batch;
+    size_t totalEvents = 0;
+    double transformSeconds = 0.0, serialSeconds = 0.0;
+    int mismatchedBlocks = 0;
+    int failures = 0;
+    for (int i = 2; i < args.size(); i++) {
+        const auto inputFile = File::getCurrentWorkingDirectory().getChildFile (args[i]);
+        MidiFile midiFile;
+        FileInputStream in (inputFile);
+        if (!in.openedOk() || !midiFile.readFrom (in)) {
+            std::cerr << "Cannot read " << inputFile.getFullPathName() << std::endl;
+            failures++;
+            continue;
+        }
+
+        std::vector<std::vector<MidiBuffer>> tracks;
+        for (int t = 0; t < midiFile.getNumTracks(); t++)
+            tracks.push_back (toBlocks (*midiFile.getTrack (t), blockSize));
+
+        if (segmented) {
+            for (auto& track : tracks) {
+                std::vector<MidiBuffer> serial;
+                if (verify)
+                    serial = track;
+                const auto start = Time::getHighResolutionTicks();
+                transform->process (track);
+                transformSeconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+                for (const auto& block : track)
+                    totalEvents += static_cast<size_t> (block.getNumEvents());
+
+                if (verify) {
+                    const auto serialStart = Time::getHighResolutionTicks();
+                    transform->processSerially (serial);
+                    serialSeconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - serialStart);
+                    for (size_t b = 0; b < track.size(); b++)
+                        if (track[b].data != serial[b].data)
+                            mismatchedBlocks++;
+                }
+            }
+        }
+        else {
+            const auto start = Time::getHighResolutionTicks();
+            batch.clear();
+            for (auto& track : tracks) {
+                for (auto& block : track)
+                    remap.gather (batch, block);
+            }
+            remap.apply (batch);
+            transformSeconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            totalEvents += batch.size();
+        }
+
+        MidiFile transformed;
+        const int timeFormat = midiFile.getTimeFormat();
+        if (timeFormat > 0)
+            transformed.setTicksPerQuarterNote (timeFormat);
+        else
+            transformed.setSmpteTimeFormat (-(timeFormat >> 8), timeFormat & 0xff);
+        for (const auto& track : tracks)
+            transformed.addTrack (toSequence (track));
+
+        const auto outputFile = outputFolder.getChildFile (inputFile.getFileName());
+        outputFile.deleteFile();
+        FileOutputStream out (outputFile);
+        if (!out.openedOk() || !transformed.writeTo (out)) {
+            std::cerr << "Cannot write " << outputFile.getFullPathName() << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision (2);
+    if (segmented) {
+        std::cout << "threads:            " << transform->getNumThreads() << std::endl
+                  << "events transformed: " << totalEvents << std::endl
+                  << "transform:          " << transformSeconds * 1.0e3 << " ms";
+    }
+    else {
+        std::cout << "kernel:          " << aas::getRemapKernelName() << std::endl
+                  << "events remapped: " << totalEvents << std::endl
+                  << "gather, remap and scatter: " << transformSeconds * 1.0e3 << " ms";
+    }
+    if (transformSeconds > 0.0)
+        std::cout << " (" << static_cast<double> (totalEvents) / transformSeconds / 1.0e6 << " M events/s)";
+    std::cout << std::endl;
+    if (segmented && verify) {
+        std::cout << "serial:             " << serialSeconds * 1.0e3 << " ms";
+        if (transformSeconds > 0.0)
+            std::cout << " (" << serialSeconds / transformSeconds << "x slower)";
+        std::cout << std::endl << "mismatched blocks:  " << mismatchedBlocks << std::endl;
+    }
+
+    return failures == 0 && mismatchedBlocks == 0 ? 0 : 2;
+}
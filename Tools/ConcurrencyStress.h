@@ -0,0 +1,75 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  ConcurrencyStress
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Runs random editor edits against the audio thread, for ThreadSanitizer.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1, JUCE_MODAL_LOOPS_PERMITTED=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "EditorOperations.h"
+
+/**
+ * Replays random edits through the plugin's editor on the message thread (adding, dragging and erasing points,
+ * cycling curve types, changing dropdowns, storing and recalling programs, painting) while an audio thread runs
+ * processBlock() on dense traffic, for ThreadSanitizer to check every access the two threads share.
+ *
+ * Usage: ConcurrencyStress [--seconds N] [--seed S]
+ *
+ * Build it with -fsanitize=thread. A data race is reported by ThreadSanitizer itself (run with
+ * TSAN_OPTIONS=halt_on_error=1 to stop at the first one); the tool prints how many edits of each kind it made and how
+ * long the audio thread's blocks took. A run is repeatable from its seed, as far as thread timing allows.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const int secondsIndex = args.indexOf ("--seconds");
+    const double seconds = secondsIndex >= 0 ? jmax (0.1, args[secondsIndex + 1].getDoubleValue()) : 10.0;
+    const int seedIndex = args.indexOf ("--seed");
+    const int64 seed = seedIndex >= 0 ? args[seedIndex + 1].getLargeIntValue() : Time::currentTimeMillis();
+
+    MidiTransformerPluginProcessor processor;
+    RandomEditorOperations operations (processor, seed);
+    AudioThread audioThread (processor, 256);
+
+    std::cout << "seed: " << seed << std::endl;
+    audioThread.start();
+    const auto end = Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+    // The message loop runs between batches of edits, so that the processor's and the editor's timers (picking up
+    // program changes, baked surfaces and telemetry) race the audio thread too, as they do in a host
+    constexpr int operationsPerBatch = 16;
+    while (Time::getMillisecondCounterHiRes() < end) {
+        for (int i = 0; i < operationsPerBatch; i++)
+            operations.perform();
+        MessageManager::getInstance()->runDispatchLoopUntil (1);
+    }
+    auto blockSeconds = audioThread.stop();
+
+    for (int i = 0; i < RandomEditorOperations::NumOperations; i++) {
+        const auto operation = static_cast<RandomEditorOperations::Operation> (i);
+        std::cout << String (RandomEditorOperations::getName (operation)).paddedRight (' ', 18) << operations.getCount (operation) << std::endl;
+    }
+    std::cout << "blocks:           " << blockSeconds.size() << std::endl
+              << "per block (us):   " << summarise (blockSeconds) << std::endl;
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  CurveEditorBenchmark
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Renders the curve editor offscreen and reports time per frame and per hit test.
+
+ dependencies:          juce_core, juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "../Source/CurveEditor.h"
+
+/**
+ * Builds a curve of the given number of nodes, cycling through the curve types, with control points placed between
+ * neighbouring anchors the way the editor would allow.
+ */
+static ValueTree createBenchmarkCurve(int numNodes) {
+    ValueTree tree{"curveState"};
+    for (int i = 0; i < numNodes; i++) {
+        const float x = 127.0f * static_cast<float> (i) / static_cast<float> (numNodes - 1);
+        const float nextX = 127.0f * static_cast<float> (jmin (i + 1, numNodes - 1)) / static_cast<float> (numNodes - 1);
+        const auto y = [](float atX) { return 63.5f + 50.0f * std::sin (atX * 0.15f); };
+        tree.addChild (ValueTree{
+                           Identifier ("pt" + String (i)), {{"curveType", i % 3}},
+                           {
+                               {"anchor", {{"x", x}, {"y", y (x)}}},
+                               {"control1", {{"x", x + (nextX - x) * 0.33f}, {"y", y (x) + 20.0f}}},
+                               {"control2", {{"x", x + (nextX - x) * 0.66f}, {"y", y (x) - 20.0f}}}
+                           }
+                       }, -1, nullptr);
+    }
+    return tree;
+}
+
+/** Percentiles of a set of timings, in microseconds */
+static String summarise(std::vector<double>& seconds) {
+    if (seconds.empty())
+        return "-";
+    std::sort (seconds.begin(), seconds.end());
+    auto percentile = [&seconds](double p) { return seconds[static_cast<size_t> (p * static_cast<double> (seconds.size() - 1))] * 1.0e6; };
+    return "p50 " + String (percentile (0.5), 1) + "  p99 " + String (percentile (0.99), 1) + "  max " + String (percentile (1.0), 1);
+}
+
+static double secondsSince(int64 startTicks) {
+    return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+}
+
+/**
+ * Instantiates aas::CurveEditor against curves of 3, 50 and 1000 nodes and renders it into offscreen Images at
+ * several sizes and scale factors, with synthesized mouse input. Nothing is put on screen, so it runs without a
+ * display.
+ *
+ * Usage: CurveEditorBenchmark [--frames N]
+ *
+ * For each model, size and scale it prints, in microseconds:
+ *  - hover:   a mouse move and a paint, with the static layer already rendered
+ *  - hit:     one hit test (a mouse down with no button held, which finds the closest handle and nothing else)
+ *  - drag:    a mouse drag of the middle anchor and a paint, while the worker renders the drag previews
+ *  - layer:   an edit, a paint, and the wait until the worker has rendered the full-detail static layer
+ *
+ * The mouse pointer itself isn't synthesized, so the hover readouts follow wherever the real pointer is (or isn't).
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const int framesIndex = args.indexOf ("--frames");
+    const int frames = framesIndex >= 0 ? jmax (1, args[framesIndex + 1].getIntValue()) : 100;
+
+    const std::initializer_list<int> nodeCounts{3, 50, 1000};
+    const std::initializer_list<Rectangle<int>> sizes{{0, 0, 400, 300}, {0, 0, 800, 600}, {0, 0, 1600, 1200}};
+    const std::initializer_list<float> scales{1.0f, 2.0f};
+
+    auto mouseSource = Desktop::getInstance().getMainMouseSource();
+
+    for (const int numNodes : nodeCounts) {
+        for (const auto& size : sizes) {
+            for (const float scale : scales) {
+                aas::CurveEditorModel<float> model (0.0f, 127.0f, 0.0f, 127.0f);
+                model.fromValueTree (createBenchmarkCurve (numNodes));
+                aas::CurveEditor<float> editor (model);
+                editor.setBounds (size);
+                editor.setVisible (true);
+
+                Image image (Image::ARGB, roundToInt (static_cast<float> (size.getWidth()) * scale),
+                             roundToInt (static_cast<float> (size.getHeight()) * scale), true, SoftwareImageType());
+                auto renderFrame = [&]
+                {
+                    Graphics g (image);
+                    g.addTransform (AffineTransform::scale (scale));
+                    editor.paintEntireComponent (g, true);
+                };
+                auto waitForLayer = [&]
+                {
+                    while (!editor.isStaticLayerReady())
+                        Thread::yield();
+                };
+
+                auto makeEvent = [&](Point<float> position, ModifierKeys mods, Point<float> downPosition, bool dragged)
+                {
+                    const auto now = Time::getCurrentTime();
+                    return MouseEvent (mouseSource, position, mods, MouseInputSource::invalidPressure, MouseInputSource::invalidOrientation,
+                                       MouseInputSource::invalidRotation, MouseInputSource::invalidTiltX, MouseInputSource::invalidTiltY,
+                                       &editor, &editor, now, downPosition, now, 1, dragged);
+                };
+                // Somewhere along a diagonal sweep of the editor, for the i'th of the frames
+                auto sweep = [&](int i)
+                {
+                    const float t = static_cast<float> (i) / static_cast<float> (frames);
+                    return Point<float> (t * static_cast<float> (size.getWidth()), (0.5f + 0.4f * std::sin (t * 12.0f)) * static_cast<float> (size.getHeight()));
+                };
+
+                renderFrame();
+                waitForLayer();
+
+                std::vector<double> hover, hit, drag, layer;
+                for (int i = 0; i < frames; i++) {
+                    const auto start = Time::getHighResolutionTicks();
+                    editor.mouseMove (makeEvent (sweep (i), {}, sweep (i), false));
+                    renderFrame();
+                    hover.push_back (secondsSince (start));
+                }
+
+                for (int i = 0; i < frames; i++) {
+                    const auto event = makeEvent (sweep (i), {}, sweep (i), false);
+                    const auto start = Time::getHighResolutionTicks();
+                    editor.mouseDown (event);
+                    hit.push_back (secondsSince (start));
+                }
+
+                // Pick up the middle anchor and drag it up and down
+                const auto& middle = model.nodes[model.nodes.size() / 2]->anchor.pt;
+                const Point<float> grabPoint (middle.x / 127.0f * static_cast<float> (size.getWidth()),
+                                              (1.0f - middle.y / 127.0f) * static_cast<float> (size.getHeight()));
+                editor.mouseDown (makeEvent (grabPoint, ModifierKeys::leftButtonModifier, grabPoint, false));
+                for (int i = 0; i < frames; i++) {
+                    const auto position = grabPoint.translated (0.0f, 40.0f * std::sin (static_cast<float> (i) * 0.2f));
+                    const auto start = Time::getHighResolutionTicks();
+                    editor.mouseDrag (makeEvent (position, ModifierKeys::leftButtonModifier, grabPoint, true));
+                    renderFrame();
+                    drag.push_back (secondsSince (start));
+                }
+                editor.mouseUp (makeEvent (grabPoint, {}, grabPoint, true));
+                renderFrame();
+                waitForLayer();
+
+                for (int i = 0; i < frames; i++) {
+                    const auto start = Time::getHighResolutionTicks();
+                    ++model.revision;
+                    renderFrame();
+                    waitForLayer();
+                    layer.push_back (secondsSince (start));
+                }
+
+                std::cout << numNodes << " nodes, " << size.getWidth() << "x" << size.getHeight() << " at " << scale << "x" << std::endl
+                          << "  hover (us): " << summarise (hover) << std::endl
+                          << "  hit (us):   " << summarise (hit) << std::endl
+                          << "  drag (us):  " << summarise (drag) << std::endl
+                          << "  layer (us): " << summarise (layer) << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  CurveTables
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Bakes curves into adaptive tables and reports their size and error.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "../Source/AdaptiveCurveTable.h"
+#include "../Source/MidiCapture.h"
+
+/** A curve of one segment of the given type from (0, 0) to (127, 127), with its control points pulled into an S */
+static ValueTree createSCurve(int curveType) {
+    return ValueTree{"curveState", {}, {
+               {"pt0", {{"curveType", curveType}}, {
+                    {"anchor", {{"x", 0.0f}, {"y", 0.0f}}},
+                    {"control1", {{"x", 100.0f}, {"y", 0.0f}}},
+                    {"control2", {{"x", 27.0f}, {"y", 127.0f}}}
+                }},
+               {"pt1", {{"curveType", 0}}, {
+                    {"anchor", {{"x", 127.0f}, {"y", 127.0f}}},
+                    {"control1", {{"x", 127.0f}, {"y", 127.0f}}},
+                    {"control2", {{"x", 127.0f}, {"y", 127.0f}}}
+                }}
+           }};
+}
+
+/** The curves to report on: those saved in a capture log's state, or a few stand-ins */
+static std::vector<std::pair<String, ValueTree>> loadCurves(const String& capturePath) {
+    std::vector<std::pair<String, ValueTree>> curves;
+    if (capturePath.isNotEmpty()) {
+        aas::CapturedSession session;
+        const auto result = session.load (File::getCurrentWorkingDirectory().getChildFile (capturePath));
+        const auto xml = result.wasOk() ? AudioProcessor::getXmlFromBinary (session.state.getData(), static_cast<int> (session.state.getSize())) : nullptr;
+        if (xml == nullptr) {
+            std::cerr << (result.failed() ? result.getErrorMessage() : "The capture log holds no plugin state") << ", using the built-in curves instead" << std::endl;
+        }
+        else {
+            const auto state = ValueTree::fromXml (*xml);
+            curves.push_back ({"live", state.getChildWithName ("curveState")});
+            for (const auto& program : state.getChildWithName ("programs"))
+                curves.push_back ({"program " + program.getProperty ("index").toString(), program.getChildWithName ("curveState")});
+            return curves;
+        }
+    }
+
+    curves.push_back ({"default", aas::CurveEditorModel<float> (0.0f, 127.0f, 0.0f, 127.0f).toValueTree ("curveState")});
+    curves.push_back ({"quadratic S", createSCurve (1)});
+    curves.push_back ({"cubic S", createSCurve (2)});
+    return curves;
+}
+
+/**
+ * Bakes every curve into an aas::AdaptiveCurveTable at several error bounds and prints what each table costs and how
+ * close it comes to the curve.
+ *
+ * Usage: CurveTables [--errors 0.5,0.02,0.002] [--state <capture.mtcap>]
+ *
+ * For each curve and bound it prints the samples and bytes the table takes, the error the baker found halfway between
+ * samples, whether that meets the bound, the largest error actually measured over every 7-bit input and every 14-bit
+ * pitch bend input, the time to bake and the time per lookup. A program whose table misses the bound still plays
+ * through it (see aas::ProgramCurve). The last line of each curve is the fixed 128-entry table the programs used
+ * before, for comparison.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    auto option = [&args](const String& name, const String& fallback)
+    {
+        const int index = args.indexOf (name);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1] : fallback;
+    };
+
+    Array<float> bounds;
+    for (const auto& bound : StringArray::fromTokens (option ("--errors", "0.5,0.02,0.002"), ",", ""))
+        bounds.add (jmax (1.0e-5f, bound.getFloatValue()));
+
+    // Pitch bend reaches the curve as value / 2^14 of the range, as in the plugin's transformMidi()
+    std::vector<float> inputs7Bit, inputs14Bit;
+    for (int i = 0; i < 128; i++)
+        inputs7Bit.push_back (static_cast<float> (i));
+    for (int i = 0; i < (1 << 14); i++)
+        inputs14Bit.push_back (static_cast<float> (i) / static_cast<float> (1 << 14) * 127.0f);
+
+    for (auto& curve : loadCurves (option ("--state", {}))) {
+        aas::CurveEditorModel<float> model (0.0f, 127.0f, 0.0f, 127.0f);
+        model.fromValueTree (curve.second);
+        auto measure = [&](auto&& lookup, const std::vector<float>& inputs)
+        {
+            float error = 0.0f;
+            for (const float input : inputs)
+                error = jmax (error, std::abs (lookup (input) - model.compute (input)));
+            return error;
+        };
+        auto timeLookups = [&](auto&& lookup)
+        {
+            constexpr int repeats = 100;
+            float sum = 0.0f;
+            const auto start = Time::getHighResolutionTicks();
+            for (int r = 0; r < repeats; r++)
+                for (const float input : inputs14Bit)
+                    sum += lookup (input);
+            const auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            // Keeps the loop from being optimised away
+            if (sum == -1.0f)
+                std::cout << sum;
+            return seconds / (repeats * inputs14Bit.size()) * 1.0e9;
+        };
+
+        std::cout << curve.first << " (" << model.nodes.size() << " nodes)" << std::endl
+                  << "  bound     samples  bytes   error (halfway)  met  error (7-bit)  error (14-bit)  bake (ms)  lookup (ns)" << std::endl;
+        std::cout << std::fixed;
+        for (const float bound : bounds) {
+            aas::AdaptiveCurveTable table;
+            const auto start = Time::getHighResolutionTicks();
+            const bool met = table.bake (model.minX, model.maxX, bound, [&model](float input) { return model.compute (input); });
+            const auto bakeSeconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            auto lookup = [&table](float input) { return table.compute (input); };
+
+            std::cout << "  " << std::setprecision (4) << std::setw (8) << bound
+                      << std::setw (9) << table.getSamples().size()
+                      << std::setw (7) << table.getMemoryBytes()
+                      << std::setw (17) << table.getAchievedError()
+                      << std::setw (5) << (met ? "yes" : "no")
+                      << std::setw (15) << measure (lookup, inputs7Bit)
+                      << std::setw (16) << measure (lookup, inputs14Bit)
+                      << std::setprecision (2) << std::setw (11) << bakeSeconds * 1.0e3
+                      << std::setw (13) << timeLookups (lookup) << std::endl;
+        }
+
+        std::array<float, 128> fixedTable;
+        for (int i = 0; i < 128; i++)
+            fixedTable[(size_t) i] = model.compute (static_cast<float> (i));
+        auto fixedLookup = [&fixedTable](float input)
+        {
+            const float position = jlimit (0.0f, 127.0f, input);
+            const int index = jmin (static_cast<int> (position), 126);
+            return fixedTable[(size_t) index] + (position - static_cast<float> (index)) * (fixedTable[(size_t) index + 1] - fixedTable[(size_t) index]);
+        };
+        std::cout << "  fixed    " << std::setw (8) << fixedTable.size() << std::setw (7) << sizeof (fixedTable)
+                  << std::setprecision (4) << std::setw (17) << "-" << std::setw (5) << "-"
+                  << std::setw (15) << measure (fixedLookup, inputs7Bit)
+                  << std::setw (16) << measure (fixedLookup, inputs14Bit)
+                  << std::setw (11) << "-"
+                  << std::setprecision (2) << std::setw (13) << timeLookups (fixedLookup) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <thread>
+#include "../Source/MidiTransformerPlugin.h"
+
+/*
+ * The two sides of a running plugin, driven without a host or a display, shared by ConcurrencyStress and
+ * LockContention: random edits through the editor on the message thread, and processBlock() on dense traffic on an
+ * audio thread of its own.
+ */
+
+/**
+ * Performs random edits through the plugin's own editor, as a user would: adding, dragging and erasing points,
+ * cycling curve types, changing dropdowns, storing and recalling programs, and painting. Message thread only.
+ *
+ * The editor's handles aren't visible from outside, so points are picked from the places the edits so far have put
+ * anchors, which keeps most drags and erases on a handle, and an edit that misses one is simply a no-op.
+ */
+class RandomEditorOperations {
+public:
+    enum Operation {
+        AddPoint = 0,
+        Drag,
+        Erase,
+        CycleCurveType,
+        ChangeDropdown,
+        StoreProgram,
+        Paint,
+        NumOperations
+    };
+
+    RandomEditorOperations(MidiTransformerPluginProcessor& processorIn, int64 seed) :
+        processor (processorIn),
+        editor (processor.createEditorIfNeeded()),
+        random (seed) {
+        editor->setVisible (true);
+        for (auto* child : editor->getChildren()) {
+            if (auto* box = dynamic_cast<ComboBox*> (child))
+                dropdowns.push_back (box);
+            else if (curveEditor == nullptr)
+                curveEditor = dynamic_cast<aas::CurveEditor<float>*> (child);
+        }
+        jassert (curveEditor != nullptr);
+
+        // Where the default curve's anchors are: both ends and the middle
+        const auto bounds = curveEditor->getLocalBounds().toFloat();
+        anchors = {bounds.getBottomLeft(), bounds.getCentre(), bounds.getTopRight()};
+        image = Image (Image::ARGB, editor->getWidth(), editor->getHeight(), true, SoftwareImageType());
+    }
+
+    static const char* getName(Operation operation) {
+        static const char* const names[] = {"add point", "drag", "erase", "cycle curve type", "change dropdown", "store program", "paint"};
+        return names[operation];
+    }
+
+    /** Perform one edit, picked at random, or the given one */
+    Operation perform(Operation operation = NumOperations) {
+        if (operation == NumOperations)
+            operation = static_cast<Operation> (random.nextInt (NumOperations));
+
+        switch (operation) {
+        case AddPoint:
+            {
+                const auto position = getRandomPosition();
+                curveEditor->mouseDoubleClick (makeEvent (position, {}, position, false));
+                if (anchors.size() < maxAnchors)
+                    anchors.push_back (position);
+            }
+            break;
+        case Drag:
+            {
+                const auto index = static_cast<size_t> (random.nextInt (static_cast<int> (anchors.size())));
+                const auto from = anchors[index];
+                auto to = from;
+                curveEditor->mouseDown (makeEvent (from, ModifierKeys::leftButtonModifier, from, false));
+                for (int i = 0; i < dragSteps; i++) {
+                    to = (to + getRandomPosition()) * 0.5f;
+                    curveEditor->mouseDrag (makeEvent (to, ModifierKeys::leftButtonModifier, from, true));
+                }
+                curveEditor->mouseUp (makeEvent (to, {}, from, true));
+                anchors[index] = to;
+            }
+            break;
+        case Erase:
+            {
+                const auto index = static_cast<size_t> (random.nextInt (static_cast<int> (anchors.size())));
+                const auto position = anchors[index];
+                curveEditor->mouseDown (makeEvent (position, ModifierKeys::rightButtonModifier, position, false));
+                curveEditor->mouseUp (makeEvent (position, {}, position, false));
+                if (anchors.size() > 3)
+                    anchors.erase (anchors.begin() + static_cast<std::ptrdiff_t> (index));
+            }
+            break;
+        case CycleCurveType:
+            {
+                const auto position = anchors[static_cast<size_t> (random.nextInt (static_cast<int> (anchors.size())))];
+                curveEditor->mouseDoubleClick (makeEvent (position, {}, position, false));
+            }
+            break;
+        case ChangeDropdown:
+            if (!dropdowns.empty()) {
+                auto* box = dropdowns[static_cast<size_t> (random.nextInt (static_cast<int> (dropdowns.size())))];
+                if (box->getNumItems() > 0)
+                    box->setSelectedItemIndex (random.nextInt (box->getNumItems()), sendNotificationSync);
+            }
+            break;
+        case StoreProgram:
+            if (random.nextBool())
+                processor.storeProgram (random.nextInt (numPrograms), "Stress");
+            else
+                processor.setCurrentProgram (random.nextInt (numPrograms));
+            break;
+        case Paint:
+        case NumOperations:
+            {
+                Graphics g (image);
+                editor->paintEntireComponent (g, true);
+            }
+            break;
+        }
+        counts[(size_t) operation]++;
+        return operation;
+    }
+
+    int getCount(Operation operation) const noexcept { return counts[(size_t) operation]; }
+
+private:
+    static constexpr size_t maxAnchors = 64;
+    static constexpr int dragSteps = 8;
+    static constexpr int numPrograms = 8;
+
+    Point<float> getRandomPosition() {
+        const auto bounds = curveEditor->getLocalBounds().toFloat();
+        return {bounds.getX() + random.nextFloat() * bounds.getWidth(), bounds.getY() + random.nextFloat() * bounds.getHeight()};
+    }
+
+    MouseEvent makeEvent(Point<float> position, ModifierKeys mods, Point<float> downPosition, bool dragged) const {
+        const auto now = Time::getCurrentTime();
+        return MouseEvent (Desktop::getInstance().getMainMouseSource(), position, mods, MouseInputSource::invalidPressure,
+                           MouseInputSource::invalidOrientation, MouseInputSource::invalidRotation, MouseInputSource::invalidTiltX,
+                           MouseInputSource::invalidTiltY, curveEditor, curveEditor, now, downPosition, now, 1, dragged);
+    }
+
+    MidiTransformerPluginProcessor& processor;
+    std::unique_ptr<AudioProcessorEditor> editor;
+    aas::CurveEditor<float>* curveEditor = nullptr;
+    std::vector<ComboBox*> dropdowns;
+    std::vector<Point<float>> anchors;
+    Random random;
+    Image image;
+    std::array<int, NumOperations> counts{};
+};
+
+/**
+ * Runs processBlock() on a thread of its own, block after block as fast as it will go, on dense traffic: a controller,
+ * pitch bend and note on every few samples, and an occasional program change. Times every block.
+ */
+class AudioThread {
+public:
+    AudioThread(MidiTransformerPluginProcessor& processorIn, int blockSizeIn) :
+        processor (processorIn),
+        blockSize (blockSizeIn),
+        audio (jmax (2, processorIn.getTotalNumOutputChannels()), blockSizeIn) {
+        processor.prepareToPlay (44100.0, blockSize);
+        for (int i = 0; i < blockSize; i += 4) {
+            traffic.addEvent (MidiMessage::controllerEvent (1 + i % 16, 1, i % 128), i);
+            traffic.addEvent (MidiMessage::pitchWheel (1 + i % 16, (i * 64) % 16384), i);
+            traffic.addEvent (MidiMessage::noteOn (1 + i % 16, i % 128, static_cast<uint8> (1 + i % 127)), i);
+            if (i % 128 == 0)
+                traffic.addEvent (MidiMessage::programChange (1, (i / 128) % 8), i);
+        }
+    }
+
+    ~AudioThread() { stop(); }
+
+    void start() {
+        blockSeconds.reserve (1 << 20);
+        running = true;
+        thread = std::thread ([this]
+        {
+            MidiBuffer midi;
+            while (running) {
+                midi = traffic;
+                audio.clear();
+                const auto start = Time::getHighResolutionTicks();
+                processor.processBlock (audio, midi);
+                blockSeconds.push_back (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+            }
+        });
+    }
+
+    /** Stop the thread and take the time each block took since start() */
+    std::vector<double> stop() {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+        std::vector<double> seconds;
+        std::swap (seconds, blockSeconds);
+        return seconds;
+    }
+
+    /** How long a block lasts at the sample rate it is prepared for */
+    double getBlockPeriod() const noexcept { return static_cast<double> (blockSize) / 44100.0; }
+
+private:
+    MidiTransformerPluginProcessor& processor;
+    const int blockSize;
+    AudioBuffer<float> audio;
+    MidiBuffer traffic;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::vector<double> blockSeconds;
+};
+
+/** Percentiles of a set of timings, in microseconds */
+static String summarise(std::vector<double>& seconds) {
+    if (seconds.empty())
+        return "-";
+    std::sort (seconds.begin(), seconds.end());
+    auto percentile = [&seconds](double p) { return seconds[static_cast<size_t> (p * static_cast<double> (seconds.size() - 1))] * 1.0e6; };
+    return "p50 " + String (percentile (0.5), 1) + "  p99 " + String (percentile (0.99), 1) + "  max " + String (percentile (1.0), 1);
+}
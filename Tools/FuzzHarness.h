@@ -0,0 +1,332 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  FuzzHarness
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Fuzzes MIDI-Transformer's state loader and event path.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "../Source/MidiTransformerPlugin.h"
+
+/*
+ * Two fuzz targets, each taking one input of arbitrary bytes:
+ *
+ *  - state: the bytes go to setStateInformation() as they are, and again as the XML of a blob in the form
+ *    copyXmlToBinary() writes, so that the XML parser and everything behind it see them too. The restored state must
+ *    process a block, and saving it, restoring that into a new instance and saving again must give the same blob.
+ *  - events: the bytes are a stream of MIDI, each message preceded by a byte of delay in samples, played through
+ *    processBlock() in 512-sample blocks with the routing picked by the first two bytes. Every output event must be a
+ *    valid message inside its block.
+ *
+ * A broken check aborts, so that a fuzzer or a sanitizer reports it with the input. Both targets also time themselves
+ * against a budget per byte of input, so that an input which makes the plugin pathologically slow fails as well.
+ */
+
+static constexpr int fuzzBlockSize = 512;
+
+/** Generous enough for a build with sanitizers */
+static constexpr double maxSecondsPerInputByte = 2.0e-4;
+static constexpr double minSecondsPerInput = 0.05;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "Check failed: " << what << std::endl;
+        std::abort();
+    }
+}
+
+static void checkTime(int64 startTicks, size_t numBytes) {
+    const auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+    check (seconds <= minSecondsPerInput + maxSecondsPerInputByte * static_cast<double> (numBytes), "input processed within the time budget");
+}
+
+/** Play one block through a processor and check what comes out */
+static void processAndCheck(MidiTransformerPluginProcessor& processor, AudioBuffer<float>& audio, MidiBuffer& midi) {
+    audio.clear();
+    processor.processBlock (audio, midi);
+    for (const auto metadata : midi) {
+        check (metadata.numBytes > 0, "no empty output events");
+        check (isPositiveAndBelow (metadata.samplePosition, audio.getNumSamples()), "output events inside the block");
+    }
+}
+
+static MidiBuffer createDenseTraffic() {
+    MidiBuffer midi;
+    for (int i = 0; i < fuzzBlockSize; i += 2) {
+        midi.addEvent (MidiMessage::controllerEvent (1 + i % 16, i % 128, i % 128), i);
+        midi.addEvent (MidiMessage::pitchWheel (1, (i * 32) % 16384), i);
+        midi.addEvent (MidiMessage::noteOn (1 + i % 16, i % 128, static_cast<uint8> (i % 128)), i);
+        midi.addEvent (MidiMessage::programChange (1, i % 128), i);
+    }
+    return midi;
+}
+
+static void fuzzState(const uint8* data, size_t size) {
+    const auto start = Time::getHighResolutionTicks();
+
+    // The bytes as a blob, then as the XML inside one (see AudioProcessor::copyXmlToBinary)
+    MemoryBlock wrapped;
+    MemoryOutputStream out (wrapped, false);
+    out.writeInt (0x21324356);
+    out.writeInt (static_cast<int> (size) + 1);
+    out.write (data, size);
+    out.writeByte (0);
+    out.flush();
+
+    MidiTransformerPluginProcessor processor;
+    processor.prepareToPlay (44100.0, fuzzBlockSize);
+    AudioBuffer<float> audio (jmax (2, processor.getTotalNumOutputChannels()), fuzzBlockSize);
+    const std::pair<const void*, size_t> blobs[] = {{data, size}, {wrapped.getData(), wrapped.getSize()}};
+    for (const auto& blob : blobs) {
+        processor.setStateInformation (blob.first, static_cast<int> (blob.second));
+        auto midi = createDenseTraffic();
+        processAndCheck (processor, audio, midi);
+    }
+
+    MemoryBlock saved, savedAgain;
+    processor.getStateInformation (saved);
+    {
+        MidiTransformerPluginProcessor restored;
+        restored.setStateInformation (saved.getData(), static_cast<int> (saved.getSize()));
+        restored.getStateInformation (savedAgain);
+    }
+    check (saved == savedAgain, "a saved state restores to the same state");
+    checkTime (start, size);
+}
+
+/** One processor, with a few programs of different routings stored, reset before each input */
+static MidiTransformerPluginProcessor& getEventProcessor() {
+    static MidiTransformerPluginProcessor processor;
+    static const bool initialised = [&]
+    {
+        const std::pair<int, int> programRoutings[] = {{2, 8}, {-2, -2}, {-1, -1}, {-3, -2}, {-1, 11}};
+        for (int i = 0; i < numElementsInArray (programRoutings); i++) {
+            processor.setRouting (programRoutings[i].first, programRoutings[i].second);
+            processor.storeProgram (i, "Fuzz " + String (i));
+        }
+        processor.prepareToPlay (44100.0, fuzzBlockSize);
+        return true;
+    }();
+    ignoreUnused (initialised);
+    return processor;
+}
+
+static void fuzzEvents(const uint8* data, size_t size) {
+    if (size < 2)
+        return;
+    const auto start = Time::getHighResolutionTicks();
+
+    // Dropdown ids from -3 (the sidechain) to 128 (CC 127)
+    auto& processor = getEventProcessor();
+    processor.setRouting (static_cast<int> (data[0] % 132) - 3, static_cast<int> (data[1] % 131) - 2);
+    processor.setTransformCheckpoint ({});
+
+    AudioBuffer<float> audio (jmax (2, processor.getTotalNumOutputChannels()), fuzzBlockSize);
+    MidiBuffer midi;
+    int position = 0;
+    uint8 lastStatus = 0;
+    for (size_t i = 2; i < size;) {
+        position += data[i++];
+        if (i >= size)
+            break;
+        while (position >= fuzzBlockSize) {
+            processAndCheck (processor, audio, midi);
+            midi.clear();
+            position -= fuzzBlockSize;
+        }
+        int numBytesUsed = 0;
+        const MidiMessage message (data + i, static_cast<int> (size - i), numBytesUsed, lastStatus, 0.0, false);
+        // A data byte with no running status to complete is skipped
+        i += static_cast<size_t> (jmax (1, numBytesUsed));
+        if (message.getRawDataSize() > 0) {
+            midi.addEvent (message, position);
+            if (message.getRawData()[0] < 0xf0)
+                lastStatus = message.getRawData()[0];
+        }
+    }
+    processAndCheck (processor, audio, midi);
+    checkTime (start, size);
+}
+
+#if MT_LIBFUZZER
+/*
+ * Built with -fsanitize=fuzzer, MT_FUZZ_TARGET picks the target ("state" unless it says "events"), and libFuzzer
+ * drives it with its own corpus and mutations.
+ */
+static bool fuzzingEvents = false;
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    static ScopedJuceInitialiser_GUI juceInitialiser;
+    fuzzingEvents = SystemStats::getEnvironmentVariable ("MT_FUZZ_TARGET", "state") == "events";
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (fuzzingEvents)
+        fuzzEvents (data, size);
+    else
+        fuzzState (data, size);
+    return 0;
+}
+#else
+/**
+ * Time a target on inputs built by createInput() at one size and at eight times that size. The time per byte must
+ * not grow by more than a factor of two, which anything quadratic in its input breaks.
+ */
+template <typename Target, typename CreateInput>
+static bool checkScaling(const char* name, Target target, CreateInput createInput, size_t size) {
+    auto timePerByte = [&](size_t inputSize)
+    {
+        const auto input = createInput (inputSize);
+        const auto start = Time::getHighResolutionTicks();
+        target (static_cast<const uint8*> (input.getData()), input.getSize());
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) / static_cast<double> (input.getSize());
+    };
+    timePerByte (size);
+    const auto small = timePerByte (size);
+    const auto large = timePerByte (size * 8);
+    std::cout << std::fixed << std::setprecision (3) << name << ": " << small * 1.0e9 << " ns per byte, "
+              << large * 1.0e9 << " ns per byte at 8x the size" << std::endl;
+    return large <= small * 2.0;
+}
+
+/** A curve of numNodes cubic segments, as the XML of a state */
+static MemoryBlock createCurveState(size_t numNodes) {
+    String xml ("<state><curveState>");
+    for (size_t i = 0; i < numNodes; i++) {
+        const auto x = 127.0 * static_cast<double> (i) / static_cast<double> (numNodes - 1);
+        xml << "<pt" << String (i) << " curveType=\"2\"><anchor x=\"" << x << "\" y=\"" << (i % 2 == 0 ? 0 : 127) << "\"/>"
+            << "<control1 x=\"" << x << "\" y=\"64\"/><control2 x=\"" << x << "\" y=\"64\"/></pt" << String (i) << ">";
+    }
+    xml << "</curveState></state>";
+    return MemoryBlock (xml.toRawUTF8(), xml.getNumBytesAsUTF8());
+}
+
+/** Dense, mixed MIDI in the events target's format, with the controller routing */
+static MemoryBlock createEventStream(size_t size) {
+    Random random (size);
+    MemoryOutputStream out;
+    out.writeByte (2);
+    out.writeByte (8);
+    while (out.getDataSize() < size) {
+        out.writeByte (static_cast<char> (random.nextInt (4)));
+        out.writeByte (static_cast<char> (0xb0 | random.nextInt (16)));
+        out.writeByte (static_cast<char> (random.nextInt (2)));
+        out.writeByte (static_cast<char> (random.nextInt (128)));
+    }
+    return out.getMemoryBlock();
+}
+
+/** Flip, insert, delete and duplicate a few bytes */
+static MemoryBlock mutate(const MemoryBlock& input, Random& random) {
+    MemoryBlock output (input);
+    const int numMutations = 1 + random.nextInt (8);
+    for (int m = 0; m < numMutations; m++) {
+        const auto size = output.getSize();
+        const auto at = size > 0 ? static_cast<size_t> (random.nextInt (static_cast<int> (size))) : 0;
+        switch (random.nextInt (4)) {
+        case 0:
+            if (size > 0)
+                output[at] = static_cast<char> (output[at] ^ (1 << random.nextInt (8)));
+            break;
+        case 1:
+            {
+                const char byte = static_cast<char> (random.nextInt (256));
+                output.insert (&byte, 1, at);
+            }
+            break;
+        case 2:
+            if (size > 0)
+                output.removeSection (at, jmin (size - at, static_cast<size_t> (1 + random.nextInt (16))));
+            break;
+        default:
+            if (size > 0) {
+                const auto length = jmin (size - at, static_cast<size_t> (1 + random.nextInt (64)));
+                const MemoryBlock section (static_cast<const char*> (output.getData()) + at, length);
+                output.insert (section.getData(), length, static_cast<size_t> (random.nextInt (static_cast<int> (size))));
+            }
+            break;
+        }
+    }
+    return output;
+}
+
+/**
+ * Runs a fuzz target without libFuzzer: every file of a corpus, then random mutations of them, then the scaling
+ * checks. A run is repeatable from its seed, so an input that aborts (under ASan, UBSan or TSan) can be found again.
+ *
+ * Usage: FuzzHarness state|events <corpus folder>... [--runs N] [--seed S]
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const int runsIndex = args.indexOf ("--runs");
+    const int runs = runsIndex >= 0 ? jmax (0, args[runsIndex + 1].getIntValue()) : 10000;
+    if (runsIndex >= 0)
+        args.removeRange (runsIndex, 2);
+    const int seedIndex = args.indexOf ("--seed");
+    const int64 seed = seedIndex >= 0 ? args[seedIndex + 1].getLargeIntValue() : Time::currentTimeMillis();
+    if (seedIndex >= 0)
+        args.removeRange (seedIndex, 2);
+    if (args.size() < 2 || (args[0] != "state" && args[0] != "events")) {
+        std::cout << "Usage: FuzzHarness state|events <corpus folder>... [--runs N] [--seed S]" << std::endl;
+        return 1;
+    }
+    const bool events = args[0] == "events";
+    auto target = events ? fuzzEvents : fuzzState;
+
+    std::vector<MemoryBlock> corpus;
+    for (int i = 1; i < args.size(); i++) {
+        for (const auto& file : File::getCurrentWorkingDirectory().getChildFile (args[i]).findChildFiles (File::findFiles, true)) {
+            corpus.emplace_back();
+            file.loadFileAsData (corpus.back());
+        }
+    }
+    if (corpus.empty()) {
+        std::cerr << "The corpus is empty" << std::endl;
+        return 1;
+    }
+
+    for (const auto& input : corpus)
+        target (static_cast<const uint8*> (input.getData()), input.getSize());
+    std::cout << "corpus:    " << corpus.size() << " inputs" << std::endl;
+
+    std::cout << "seed:      " << seed << std::endl;
+    Random random (seed);
+    for (int run = 0; run < runs; run++) {
+        const auto input = mutate (corpus[(size_t) random.nextInt (static_cast<int> (corpus.size()))], random);
+        target (static_cast<const uint8*> (input.getData()), input.getSize());
+    }
+    std::cout << "mutations: " << runs << std::endl;
+
+    const bool scales = events ? checkScaling ("events", fuzzEvents, createEventStream, 1 << 16)
+                               : checkScaling ("state", fuzzState, [](size_t size) { return createCurveState (size / 256); }, 1 << 14);
+    if (!scales) {
+        std::cerr << "Processing time grows faster than the input" << std::endl;
+        return 2;
+    }
+    return 0;
+}
+#endif
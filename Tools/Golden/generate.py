@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Writes the golden corpus that Tools/GoldenOutputs.h checks: for every case, the saved state (state.xml), the input
+events (input.txt) and the output the plugin must produce from them (expected.txt).
+
+The expected output is worked out here, independently of the plugin, from the curve maths in Source/CurveFunction.h
+and the value paths in MidiTransformerPluginProcessor::transformMidi(), with every float operation rounded to single
+precision as the plugin rounds it. Every curve has power-of-two slopes, so a product is never rounded and the
+result is the same whether or not the compiler fuses a multiply and an add.
+
+Event lines are "<sample position> <bytes in hex>", in buffer order.
+
+Usage: generate.py [corpus folder, this script's folder by default]
+"""
+
+import os
+import struct
+import sys
+
+
+def f32(value):
+    return struct.unpack("f", struct.pack("f", value))[0]
+
+
+class Curve:
+    """A curve of linear segments between (x, y) anchors, evaluated as CurveEditorModel::compute() does"""
+
+    def __init__(self, anchors):
+        self.anchors = [(float(x), float(y)) for x, y in anchors]
+
+    def compute(self, value):
+        value = min(max(value, 0.0), 127.0)
+        for (sx, sy), (ex, ey) in zip(self.anchors, self.anchors[1:]):
+            if value <= ex:
+                if ex <= sx:
+                    return ey
+                slope = f32(f32(ey - sy) / f32(ex - sx))
+                return f32(f32(slope * f32(value - sx)) + sy)
+        return self.anchors[-1][1]
+
+    def to_xml(self, name):
+        lines = ["  <%s>" % name]
+        for i, (x, y) in enumerate(self.anchors):
+            lines.append('    <pt%d curveType="0">' % i)
+            for handle in ("anchor", "control1", "control2"):
+                lines.append('      <%s x="%g" y="%g"/>' % (handle, x, y))
+            lines.append("    </pt%d>" % i)
+        lines.append("  </%s>" % name)
+        return lines
+
+
+# Dropdown ids, as saved in uiState
+VELOCITY = -1
+PITCH = -2
+
+
+def cc(number):
+    return number + 1
+
+
+def round_half_even(value):
+    return int(round(value))
+
+
+def transform(events, curve, input_id, output_id, programs=None):
+    """transformMidi() over the whole input, for a state without zones or a second axis"""
+    programs = programs or {}
+    routing = (curve, input_id - 1, output_id - 1)
+    output = []
+    for position, data in events:
+        status = data[0]
+        kind, channel = status & 0xF0, (status & 0x0F) + 1
+        if kind == 0xC0 and len(data) == 2 and data[1] in programs:
+            program_curve, program_input, program_output = programs[data[1]]
+            routing = (program_curve, program_input - 1, program_output - 1)
+        active_curve, cc_in, cc_out = routing
+
+        is_note_on = kind == 0x90 and len(data) == 3
+        if kind == 0xB0 and len(data) == 3 and data[1] == cc_in:
+            value = float(data[2])
+        elif cc_in == VELOCITY - 1 and is_note_on:
+            value = float(data[2])
+        elif cc_in == PITCH - 1 and kind == 0xE0 and len(data) == 3:
+            value = f32(f32(float(data[1] | (data[2] << 7)) / 16384.0) * 127.0)
+        else:
+            # A note on with velocity as the output would read the last input; no case here routes that way
+            assert not (cc_out == VELOCITY - 1 and is_note_on)
+            output.append((position, data))
+            continue
+
+        if cc_in == VELOCITY - 1 and cc_out != VELOCITY - 1:
+            output.append((position, data))
+
+        result = active_curve.compute(value)
+        if cc_out >= 0:
+            output.append((position, bytes([0xB0 | (channel - 1), cc_out, min(max(int(result), 0), 127)])))
+        elif cc_out == PITCH - 1:
+            bend = min(max(int(f32(f32(result * 16384.0) / 127.0)), 0), 16383)
+            output.append((position, bytes([0xE0 | (channel - 1), bend & 0x7F, bend >> 7])))
+        elif cc_out == VELOCITY - 1 and is_note_on:
+            velocity = min(max(round_half_even(f32(f32(result / 127.0) * 127.0)), 0), 127)
+            output.append((position, bytes([data[0], data[1], velocity])))
+    return output
+
+
+def state_xml(curve, input_id, output_id, programs=None, current_program=-1):
+    lines = ['<?xml version="1.0" encoding="UTF-8"?>', "", "<state>"]
+    lines += curve.to_xml("curveState")
+    if programs:
+        lines.append('  <programs currentProgram="%d">' % current_program)
+        for index, (program_curve, program_input, program_output) in sorted(programs.items()):
+            lines.append('    <program index="%d" name="Program %d" midiInput="%d" midiOutput="%d" surfaceAxis="1">'
+                         % (index, index, program_input, program_output))
+            lines += ["    " + line for line in program_curve.to_xml("curveState")]
+            lines.append("    </program>")
+        lines.append("  </programs>")
+    lines.append('  <uiState midiInput="%d" midiOutput="%d"/>' % (input_id, output_id))
+    lines.append("</state>")
+    return "\n".join(lines) + "\n"
+
+
+def write_events(path, events):
+    with open(path, "w") as out:
+        for position, data in events:
+            out.write("%d %s\n" % (position, " ".join("%02x" % byte for byte in data)))
+
+
+S_CURVE = Curve([(0, 0), (64, 32), (96, 96), (127, 127)])
+
+
+def cc_sweep():
+    events = []
+    for i in range(128):
+        events.append((i * 4, bytes([0xB0, 1, i])))
+        if i % 16 == 0:
+            events.append((i * 4, bytes([0xB0, 7, 100])))
+            events.append((i * 4, bytes([0x90, 60, 90])))
+    for i in range(128):
+        position = 512 + i * 2
+        events.append((position, bytes([0xB1, 1, 127 - i])))
+        events.append((position, bytes([0xBF, 1, (i * 37) % 128])))
+    events.append((800, bytes([0xB0, 64, 127])))
+    events.append((800, bytes([0x80, 60, 0])))
+    return S_CURVE, cc(1), cc(7), events
+
+
+def pitch_glide():
+    events = []
+    for i, bend in enumerate(list(range(0, 16384, 37)) + [16383]):
+        events.append((i * 3, bytes([0xE2, bend & 0x7F, bend >> 7])))
+    for i, bend in enumerate(range(16383, -1, -211)):
+        events.append((1400 + i * 5, bytes([0xE3, bend & 0x7F, bend >> 7])))
+        events.append((1400 + i * 5, bytes([0xB3, 1, i % 128])))
+    return Curve([(0, 0), (32, 64), (96, 96), (127, 127)]), PITCH, PITCH, events
+
+
+def velocity_run():
+    events = []
+    for velocity in range(1, 128):
+        note = 36 + velocity % 48
+        events.append((velocity * 8, bytes([0x90 | (velocity % 4), note, velocity])))
+        events.append((velocity * 8 + 4, bytes([0x80 | (velocity % 4), note, 64])))
+    return Curve([(0, 16), (32, 32), (127, 127)]), VELOCITY, VELOCITY, events
+
+
+def mixed_sysex():
+    events = [
+        (0, bytes([0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7])),
+        (0, bytes([0xFA])),
+        (10, bytes([0xF8])),
+        (10, bytes([0xB0, 1, 0])),
+        (12, bytes([0xC0, 5])),
+        (20, bytes([0xD0, 64])),
+        (21, bytes([0xA0, 60, 32])),
+        (22, bytes([0x90, 60, 0])),
+        (22, bytes([0x90, 62, 100])),
+        (30, bytes([0xE0, 0, 64])),
+        (31, bytes([0xF0, 0x43, 0x10, 0x4C, 0x00, 0x00, 0x7E, 0x00, 0xF7])),
+        (31, bytes([0xB5, 1, 127])),
+        (40, bytes([0xF2, 0x10, 0x02])),
+        (41, bytes([0xFE])),
+    ]
+    for i in range(64):
+        position = 50 + i
+        events.append((position, bytes([0xB0 | (i % 16), 1, (i * 2) % 128])))
+        if i % 8 == 0:
+            events.append((position, bytes([0xF8])))
+        if i % 21 == 0:
+            events.append((position, bytes([0xF0, 0x7D, i, 0xF7])))
+    events.append((200, bytes([0xFC])))
+    return Curve([(0, 127), (127, 0)]), cc(1), PITCH, events
+
+
+def program_change():
+    programs = {
+        2: (Curve([(0, 127), (127, 0)]), cc(1), cc(1)),
+        5: (Curve([(0, 0), (64, 32), (127, 95)]), cc(1), cc(10)),
+    }
+    events = []
+    position = 0
+    for change in (None, 2, 5, 9, 2):
+        if change is not None:
+            events.append((position, bytes([0xC0, change])))
+        for value in range(0, 128, 9):
+            events.append((position, bytes([0xB0, 1, value])))
+            position += 2
+    return Curve([(0, 0), (127, 127)]), cc(1), cc(1), events, programs
+
+
+def main():
+    folder = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    for case in (cc_sweep, pitch_glide, velocity_run, mixed_sysex, program_change):
+        curve, input_id, output_id, events, *rest = case()
+        programs = rest[0] if rest else None
+        events.sort(key=lambda event: event[0])
+        case_folder = os.path.join(folder, case.__name__)
+        os.makedirs(case_folder, exist_ok=True)
+        with open(os.path.join(case_folder, "state.xml"), "w") as out:
+            out.write(state_xml(curve, input_id, output_id, programs))
+        write_events(os.path.join(case_folder, "input.txt"), events)
+        write_events(os.path.join(case_folder, "expected.txt"), transform(events, curve, input_id, output_id, programs))
+
+
+if __name__ == "__main__":
+    main()
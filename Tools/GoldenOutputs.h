@@ -0,0 +1,189 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  GoldenOutputs
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Checks MIDI-Transformer's output against a corpus of golden outputs.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "OfflineTransform.h"
+
+/** Events written one per line as "<sample position> <bytes in hex>", the form of the corpus files */
+static String toText(const MidiBuffer& midi) {
+    String text;
+    for (const auto metadata : midi)
+        text << metadata.samplePosition << " " << String::toHexString (metadata.data, metadata.numBytes) << "\n";
+    return text;
+}
+
+static MidiBuffer fromText(const String& text) {
+    MidiBuffer midi;
+    for (const auto& line : StringArray::fromLines (text)) {
+        const auto tokens = StringArray::fromTokens (line, " ", "");
+        if (tokens.size() < 2)
+            continue;
+        std::vector<uint8> bytes;
+        for (int i = 1; i < tokens.size(); i++)
+            bytes.push_back (static_cast<uint8> (tokens[i].getHexValue32()));
+        midi.addEvent (MidiMessage (bytes.data(), static_cast<int> (bytes.size())), tokens[0].getIntValue());
+    }
+    return midi;
+}
+
+/** A buffer as a sequence with its sample positions as times, as BatchTransform reads a MIDI file's track */
+static MidiMessageSequence toTrack(const MidiBuffer& midi) {
+    MidiMessageSequence track;
+    for (const auto metadata : midi)
+        track.addEvent (metadata.getMessage(), 0.0);
+    return track;
+}
+
+static MidiBuffer join(const std::vector<MidiBuffer>& blocks) {
+    MidiBuffer midi;
+    for (const auto& block : blocks)
+        midi.addEvents (block, 0, -1, 0);
+    return midi;
+}
+
+/** \return an empty string if the output matches, or where it first differs */
+static String compare(const String& expected, const String& actual) {
+    const auto expectedLines = StringArray::fromLines (expected.trimEnd());
+    const auto actualLines = StringArray::fromLines (actual.trimEnd());
+    for (int i = 0; i < jmax (expectedLines.size(), actualLines.size()); i++)
+        if (expectedLines[i] != actualLines[i])
+            return "line " + String (i + 1) + ": expected \"" + expectedLines[i] + "\", got \"" + actualLines[i] + "\"";
+    return {};
+}
+
+/**
+ * Checks that the plugin, and the offline tools built on it, still give the checked-in output for every case of a
+ * golden corpus, byte for byte, so that a change to a table or a solver can't alter the output unnoticed.
+ *
+ * Usage: GoldenOutputs <corpus folder> [--update]
+ *
+ * Each folder in the corpus (Tools/Golden) is a case: a saved state (state.xml), the events going in (input.txt) and
+ * the events that must come out (expected.txt). Every case is run through transformMidi() in one buffer, through
+ * processBlock() in 64-sample blocks, through BatchTransform's SegmentedTransform on four threads, and through its
+ * byte remap if the state allows one. Any run whose output differs is reported with the first line that differs.
+ *
+ * --update rewrites every expected.txt from transformMidi() instead, for a change that is meant to alter the output,
+ * so that the diff shows what it altered.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const bool update = args.contains ("--update");
+    args.removeString ("--update");
+    if (args.isEmpty()) {
+        std::cout << "Usage: GoldenOutputs <corpus folder> [--update]" << std::endl;
+        return 1;
+    }
+
+    const auto corpus = File::getCurrentWorkingDirectory().getChildFile (args[0]);
+    auto cases = corpus.findChildFiles (File::findDirectories, false);
+    cases.sort();
+    if (cases.isEmpty()) {
+        std::cerr << "No cases in " << corpus.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    constexpr int blockSize = 64;
+    constexpr int numThreads = 4;
+    constexpr int eventsPerBlock = 8;
+    int failures = 0;
+    for (const auto& folder : cases) {
+        const auto xml = parseXML (folder.getChildFile ("state.xml"));
+        const auto inputFile = folder.getChildFile ("input.txt");
+        const auto expectedFile = folder.getChildFile ("expected.txt");
+        if (xml == nullptr || !inputFile.existsAsFile() || (!update && !expectedFile.existsAsFile())) {
+            std::cerr << folder.getFileName() << ": needs state.xml, input.txt and expected.txt" << std::endl;
+            failures++;
+            continue;
+        }
+        MemoryBlock state;
+        AudioProcessor::copyXmlToBinary (*xml, state);
+        const auto input = fromText (inputFile.loadFileAsString());
+
+        // The reference run: the whole input in one buffer
+        MidiBuffer transformed (input);
+        {
+            MidiTransformerPluginProcessor processor;
+            processor.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+            processor.transformMidi (transformed);
+        }
+        if (update) {
+            expectedFile.replaceWithText (toText (transformed));
+            std::cout << folder.getFileName() << ": updated" << std::endl;
+            continue;
+        }
+
+        // As a host runs the plugin
+        MidiBuffer processed;
+        {
+            MidiTransformerPluginProcessor processor;
+            processor.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+            processor.prepareToPlay (44100.0, blockSize);
+            AudioBuffer<float> audio (processor.getTotalNumOutputChannels(), blockSize);
+            for (int start = 0; start <= input.getLastEventTime(); start += blockSize) {
+                MidiBuffer block;
+                block.addEvents (input, start, blockSize, -start);
+                audio.clear();
+                processor.processBlock (audio, block);
+                processed.addEvents (block, 0, -1, start);
+            }
+            processor.releaseResources();
+        }
+
+        // As BatchTransform runs a track, split between threads or remapped in bulk
+        auto segmentedBlocks = toBlocks (toTrack (input), eventsPerBlock);
+        SegmentedTransform (state, numThreads).process (segmentedBlocks);
+
+        std::vector<std::pair<String, MidiBuffer>> runs{
+            {"transformMidi", transformed},
+            {"processBlock", processed},
+            {"segmented", join (segmentedBlocks)}
+        };
+
+        const ByteRemapTransform remap (ValueTree::fromXml (*xml));
+        if (remap.isUsable()) {
+            auto remappedBlocks = toBlocks (toTrack (input), eventsPerBlock);
+            aas::ByteRemapBatch batch;
+            for (auto& block : remappedBlocks)
+                remap.gather (batch, block);
+            remap.apply (batch);
+            runs.emplace_back ("byte remap", join (remappedBlocks));
+        }
+
+        const auto expected = expectedFile.loadFileAsString();
+        for (const auto& run : runs) {
+            const auto difference = compare (expected, toText (run.second));
+            std::cout << folder.getFileName() << ", " << run.first << ": " << (difference.isEmpty() ? "ok" : "FAILED, " + difference) << std::endl;
+            if (difference.isNotEmpty())
+                failures++;
+        }
+    }
+
+    std::cout << failures << " failure" << (failures == 1 ? "" : "s") << std::endl;
+    return failures == 0 ? 0 : 2;
+}
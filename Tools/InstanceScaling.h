@@ -0,0 +1,224 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  InstanceScaling
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Loads many MIDI-Transformer instances at once and reports what each one costs.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "../Source/MidiTransformerPlugin.h"
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment (lib, "psapi.lib")
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+/** The process's resident memory, in bytes, or 0 where it can't be read */
+static int64 getResidentBytes() {
+   #if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof (counters)))
+        return static_cast<int64> (counters.WorkingSetSize);
+    return 0;
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info{};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t> (&info), &count) == KERN_SUCCESS)
+        return static_cast<int64> (info.resident_size);
+    return 0;
+   #elif JUCE_LINUX
+    // The second field of statm is the resident set, in pages
+    const auto fields = StringArray::fromTokens (File ("/proc/self/statm").loadFileAsString(), false);
+    return fields.size() > 1 ? fields[1].getLargeIntValue() * static_cast<int64> (sysconf (_SC_PAGESIZE)) : 0;
+   #else
+    return 0;
+   #endif
+}
+
+/**
+ * The state every instance is restored from: either the state saved in a capture log, or a stand-in for a typical
+ * session (CC 1 mapped to CC 7, with a few programs stored).
+ */
+static MemoryBlock createTypicalState(const String& capturePath) {
+    MemoryBlock state;
+    if (capturePath.isNotEmpty()) {
+        aas::CapturedSession session;
+        const auto result = session.load (File::getCurrentWorkingDirectory().getChildFile (capturePath));
+        if (result.failed())
+            std::cerr << result.getErrorMessage() << ", using the built-in state instead" << std::endl;
+        else
+            return session.state;
+    }
+
+    MidiTransformerPluginProcessor processor;
+    processor.setRouting (1 + 1, 7 + 1);
+    for (int i = 0; i < 8; i++)
+        processor.storeProgram (i, "Program " + String (i + 1));
+    processor.getStateInformation (state);
+    return state;
+}
+
+/**
+ * One block of a busy but plausible performance: a controller sweep every 2 ms, a note every 60 ms on average with
+ * its note off 50 ms later, and occasional pitch bend. The same stream goes to every instance.
+ */
+class PerformanceGenerator {
+public:
+    explicit PerformanceGenerator(double sampleRate) :
+        sampleRate (sampleRate) { }
+
+    void fillBlock(MidiBuffer& midi, int numSamples) {
+        midi.clear();
+        const auto sampleOffset = [&](double time) { return static_cast<int> ((time - blockStartSeconds) * sampleRate); };
+        const double blockEnd = blockStartSeconds + numSamples / sampleRate;
+
+        for (; nextControllerTime < blockEnd; nextControllerTime += 0.002) {
+            const int value = roundToInt (63.5 + 63.5 * std::sin (nextControllerTime * 2.0));
+            midi.addEvent (MidiMessage::controllerEvent (1, 1, value), sampleOffset (nextControllerTime));
+        }
+        for (; nextNoteTime < blockEnd; nextNoteTime += 0.01 + random.nextDouble() * 0.1) {
+            const int note = 36 + random.nextInt (48);
+            midi.addEvent (MidiMessage::noteOn (1, note, static_cast<uint8> (20 + random.nextInt (100))), sampleOffset (nextNoteTime));
+            pendingNoteOffs.push_back ({nextNoteTime + 0.05, note});
+        }
+        for (auto noteOff = pendingNoteOffs.begin(); noteOff != pendingNoteOffs.end();) {
+            if (noteOff->first < blockEnd) {
+                midi.addEvent (MidiMessage::noteOff (1, noteOff->second), jmax (0, sampleOffset (noteOff->first)));
+                noteOff = pendingNoteOffs.erase (noteOff);
+            }
+            else {
+                ++noteOff;
+            }
+        }
+        if (random.nextInt (50) == 0)
+            midi.addEvent (MidiMessage::pitchWheel (1, random.nextInt (1 << 14)), random.nextInt (numSamples));
+
+        blockStartSeconds = blockEnd;
+    }
+
+private:
+    double sampleRate;
+    double blockStartSeconds = 0.0;
+    double nextControllerTime = 0.0;
+    double nextNoteTime = 0.0;
+    std::vector<std::pair<double, int>> pendingNoteOffs;
+    Random random{1};
+};
+
+static String summarise(std::vector<double>& seconds) {
+    if (seconds.empty())
+        return "-";
+    std::sort (seconds.begin(), seconds.end());
+    auto percentile = [&seconds](double p) { return seconds[static_cast<size_t> (p * static_cast<double> (seconds.size() - 1))] * 1.0e6; };
+    return "p50 " + String (percentile (0.5), 1) + "  p99 " + String (percentile (0.99), 1) + "  max " + String (percentile (1.0), 1);
+}
+
+/**
+ * Loads N processors side by side, as a host would for a large session, restores the same state into each and
+ * drives them all with the same MIDI, one block at a time, as fast as it will go.
+ *
+ * Usage: InstanceScaling [--counts 10,100,1000] [--block 256] [--seconds 10] [--state <capture.mtcap>]
+ *
+ * For every N it prints the resident memory each instance adds, the time to construct one and to restore its state
+ * (in microseconds), and the total process() time as a share of the audio it covered, i.e. the fraction of one core
+ * the session would need in realtime. Runs without a display.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    auto option = [&args](const String& name, const String& fallback)
+    {
+        const int index = args.indexOf (name);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1] : fallback;
+    };
+
+    Array<int> counts;
+    for (const auto& count : StringArray::fromTokens (option ("--counts", "10,100,1000"), ",", ""))
+        counts.add (jmax (1, count.getIntValue()));
+    const int blockSize = jmax (1, option ("--block", "256").getIntValue());
+    const double seconds = jmax (0.1, option ("--seconds", "10").getDoubleValue());
+    const double sampleRate = 48000.0;
+
+    const auto state = createTypicalState (option ("--state", {}));
+    std::cout << "state: " << state.getSize() << " bytes, block: " << blockSize << " samples at " << sampleRate << " Hz" << std::endl;
+
+    for (const int count : counts) {
+        std::vector<std::unique_ptr<MidiTransformerPluginProcessor>> processors;
+        processors.reserve (static_cast<size_t> (count));
+        std::vector<double> constructSeconds, restoreSeconds;
+
+        const auto bytesBefore = getResidentBytes();
+        for (int i = 0; i < count; i++) {
+            auto start = Time::getHighResolutionTicks();
+            processors.push_back (std::make_unique<MidiTransformerPluginProcessor>());
+            constructSeconds.push_back (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+
+            start = Time::getHighResolutionTicks();
+            processors.back()->setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+            restoreSeconds.push_back (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+
+            processors.back()->prepareToPlay (sampleRate, blockSize);
+        }
+        const auto bytesPerInstance = (getResidentBytes() - bytesBefore) / count;
+
+        const int numChannels = jmax (processors.front()->getTotalNumInputChannels(), processors.front()->getTotalNumOutputChannels());
+        AudioBuffer<float> audio (numChannels, blockSize);
+        MidiBuffer performance, midi;
+        PerformanceGenerator generator (sampleRate);
+
+        const int numBlocks = jmax (1, roundToInt (seconds * sampleRate / blockSize));
+        double processSeconds = 0.0;
+        for (int block = 0; block < numBlocks; block++) {
+            generator.fillBlock (performance, blockSize);
+            for (auto& processor : processors) {
+                audio.clear();
+                midi = performance;
+                const auto start = Time::getHighResolutionTicks();
+                processor->processBlock (audio, midi);
+                processSeconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            }
+        }
+        const double audioSeconds = numBlocks * blockSize / sampleRate;
+
+        for (auto& processor : processors)
+            processor->releaseResources();
+
+        std::cout << std::fixed << std::setprecision (2)
+                  << count << " instances" << std::endl
+                  << "  memory per instance: " << static_cast<double> (bytesPerInstance) / 1024.0 << " KiB" << std::endl
+                  << "  construct (us):      " << summarise (constructSeconds) << std::endl
+                  << "  restore state (us):  " << summarise (restoreSeconds) << std::endl
+                  << "  process() per block: " << processSeconds / (numBlocks * count) * 1.0e6 << " us per instance" << std::endl
+                  << "  realtime load:       " << 100.0 * processSeconds / audioSeconds << "% of one core" << std::endl;
+    }
+
+    return 0;
+}
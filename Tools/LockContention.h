@@ -0,0 +1,92 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  LockContention
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Measures how edits in the editor delay MIDI-Transformer's audio thread.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "EditorOperations.h"
+
+/**
+ * Measures what the editor costs the audio thread. The audio thread shares the curves, programs and routing with the
+ * editor through one SpinLock and a few atomics, so every edit that takes the lock can hold up a block.
+ *
+ * Usage: LockContention [--seconds N] [--block N]
+ *
+ * An audio thread runs processBlock() on dense traffic, block after block, through four phases of the same length:
+ * with the editor idle, then with the message thread doing nothing but drags, nothing but dropdown changes and
+ * program stores, and any edit at random. For each phase it prints the time per block and per edit, in microseconds,
+ * and the share of blocks that took longer than the block lasts in real time at 44.1 kHz.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    const int secondsIndex = args.indexOf ("--seconds");
+    const double seconds = secondsIndex >= 0 ? jmax (0.1, args[secondsIndex + 1].getDoubleValue()) : 5.0;
+    const int blockIndex = args.indexOf ("--block");
+    const int blockSize = blockIndex >= 0 ? jlimit (16, 8192, args[blockIndex + 1].getIntValue()) : 256;
+
+    MidiTransformerPluginProcessor processor;
+    RandomEditorOperations operations (processor, 1);
+    AudioThread audioThread (processor, blockSize);
+
+    using Operation = RandomEditorOperations::Operation;
+    struct Phase {
+        const char* name;
+        std::vector<Operation> operations;
+    };
+    const Phase phases[] = {
+        {"idle", {}},
+        {"drags", {Operation::Drag}},
+        {"dropdowns and programs", {Operation::ChangeDropdown, Operation::StoreProgram}},
+        {"any edit", {Operation::NumOperations}}
+    };
+
+    std::cout << std::fixed << std::setprecision (2) << "block: " << blockSize << " samples, "
+              << audioThread.getBlockPeriod() * 1.0e6 << " us at 44.1 kHz" << std::endl;
+    for (const auto& phase : phases) {
+        std::vector<double> editSeconds;
+        audioThread.start();
+        const auto end = Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+        for (size_t i = 0; Time::getMillisecondCounterHiRes() < end; i++) {
+            if (phase.operations.empty()) {
+                Thread::sleep (1);
+                continue;
+            }
+            const auto start = Time::getHighResolutionTicks();
+            operations.perform (phase.operations[i % phase.operations.size()]);
+            editSeconds.push_back (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+        }
+        auto blockSeconds = audioThread.stop();
+
+        const auto late = std::count_if (blockSeconds.begin(), blockSeconds.end(), [&](double s) { return s > audioThread.getBlockPeriod(); });
+        std::cout << phase.name << std::endl
+                  << "  per block (us): " << summarise (blockSeconds) << std::endl
+                  << "  late blocks:    " << late << " of " << blockSeconds.size() << std::endl
+                  << "  per edit (us):  " << summarise (editSeconds) << std::endl;
+    }
+    return 0;
+}
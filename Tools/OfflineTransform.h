@@ -0,0 +1,162 @@
+#pragma once
+
+#include <thread>
+#include "../Source/ByteTableRemap.h"
+#include "../Source/MidiTransformerPlugin.h"
+
+/*
+ * The two ways the offline tools transform MIDI without a host, shared by BatchTransform and GoldenOutputs so that
+ * the golden outputs check exactly what a batch run does.
+ */
+
+/**
+ * A track cut into MidiBuffers of at most blockSize events, with the MIDI file's tick times as sample positions, so
+ * its bytes can be edited in place. Each insert into a MidiBuffer scans what it holds already, so small blocks keep
+ * a long track from costing time proportional to the square of its length.
+ */
+static std::vector<MidiBuffer> toBlocks(const MidiMessageSequence& track, int blockSize) {
+    std::vector<MidiBuffer> blocks;
+    for (int i = 0; i < track.getNumEvents(); i++) {
+        if (i % blockSize == 0)
+            blocks.emplace_back();
+        const auto& message = track.getEventPointer (i)->message;
+        blocks.back().addEvent (message, roundToInt (message.getTimeStamp()));
+    }
+    return blocks;
+}
+
+static MidiMessageSequence toSequence(const std::vector<MidiBuffer>& blocks) {
+    MidiMessageSequence track;
+    for (const auto& block : blocks)
+        for (const auto metadata : block)
+            track.addEvent (metadata.getMessage(), 0.0);
+    track.updateMatchedPairs();
+    return track;
+}
+
+/**
+ * Runs tracks through the plugin's whole transform (programs, zones and the second axis included) on several
+ * threads, with exactly the output one instance gives working through the track from start to end.
+ *
+ * A track is split into segments of whole blocks. One serial pass carries a checkpoint of what the transform
+ * remembers between events (MidiTransformerPluginProcessor::TransformCheckpoint) across each segment, without
+ * mapping anything, which costs little next to the transform itself. Each thread then takes the next segment on its
+ * own instance, restored from the same state, starts from that segment's checkpoint and transforms its blocks in
+ * place. As the blocks never move, the results are already in order.
+ */
+class SegmentedTransform {
+public:
+    /** More segments than threads, so that a thread that finishes early picks up more work */
+    static constexpr size_t segmentsPerThread = 8;
+
+    SegmentedTransform(const MemoryBlock& state, int numThreads) {
+        for (int i = 0; i < jmax (1, numThreads); i++) {
+            instances.push_back (std::make_unique<MidiTransformerPluginProcessor>());
+            instances.back()->setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+        }
+        initialCheckpoint = instances.front()->getTransformCheckpoint();
+    }
+
+    int getNumThreads() const noexcept { return static_cast<int> (instances.size()); }
+
+    /** Transform a track's blocks in place, starting from the restored state as a freshly loaded plugin would */
+    void process(std::vector<MidiBuffer>& blocks) {
+        const size_t numSegments = jmin (blocks.size(), instances.size() * segmentsPerThread);
+        if (numSegments == 0)
+            return;
+
+        // Segment s is blocks[bounds[s]] up to, but not including, blocks[bounds[s + 1]]
+        std::vector<size_t> bounds;
+        for (size_t s = 0; s <= numSegments; s++)
+            bounds.push_back (blocks.size() * s / numSegments);
+
+        std::vector<MidiTransformerPluginProcessor::TransformCheckpoint> checkpoints (numSegments, initialCheckpoint);
+        for (size_t s = 1; s < numSegments; s++) {
+            checkpoints[s] = checkpoints[s - 1];
+            for (size_t b = bounds[s - 1]; b < bounds[s]; b++)
+                instances.front()->advanceTransformCheckpoint (checkpoints[s], blocks[b]);
+        }
+
+        std::atomic<size_t> nextSegment{0};
+        auto work = [&](MidiTransformerPluginProcessor& instance)
+        {
+            for (size_t s = nextSegment++; s < numSegments; s = nextSegment++) {
+                instance.setTransformCheckpoint (checkpoints[s]);
+                for (size_t b = bounds[s]; b < bounds[s + 1]; b++)
+                    instance.transformMidi (blocks[b]);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < instances.size(); i++)
+            threads.emplace_back (work, std::ref (*instances[i]));
+        work (*instances.front());
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    /** The same as process(), on one thread and without checkpoints, to check it against */
+    void processSerially(std::vector<MidiBuffer>& blocks) {
+        instances.front()->setTransformCheckpoint (initialCheckpoint);
+        for (auto& block : blocks)
+            instances.front()->transformMidi (block);
+    }
+
+private:
+    std::vector<std::unique_ptr<MidiTransformerPluginProcessor>> instances;
+    MidiTransformerPluginProcessor::TransformCheckpoint initialCheckpoint;
+};
+
+/**
+ * Whether the state holds anything a byte remap of the main curve would leave out: keyboard zones, a second axis, or
+ * programs that a program change in the file could switch to.
+ */
+static bool needsWholeTransform(const ValueTree& state) {
+    const int surfaceAxisId = state.getChildWithName ("uiState").getProperty ("surfaceAxis", 1);
+    return state.getChildWithName ("zones").getNumChildren() > 0
+        || state.getChildWithName ("programs").getNumChildren() > 0
+        || surfaceAxisId > 1;
+}
+
+
+/**
+ * The main curve baked into a 128-byte table, and the routing it applies to, for remapping many events at once with
+ * an aas::ByteRemapBatch.
+ *
+ * Only a controller to controller or velocity to velocity routing, in a state without zones, a second axis or
+ * programs, maps every event through the main curve alone. isUsable() is false for any other state, which has to go
+ * through the plugin's own transform.
+ */
+class ByteRemapTransform {
+public:
+    explicit ByteRemapTransform(const ValueTree& state) {
+        aas::CurveEditorModel<float> curve (0.0f, 127.0f, 0.0f, 127.0f);
+        curve.fromValueTree (state.getChildWithName ("curveState"));
+
+        // Dropdown ids: -1 is velocity, n + 1 is CC n
+        const auto uiState = state.getChildWithName ("uiState");
+        const int inputId = uiState.getProperty ("midiInput", 1);
+        const int outputId = uiState.getProperty ("midiOutput", 1);
+        velocity = inputId == -1 && outputId == -1;
+        usable = !needsWholeTransform (state) && (velocity || (inputId >= 1 && outputId >= 1));
+        inputController = inputId - 1;
+        outputController = outputId - 1;
+        table = velocity ? aas::bakeVelocityTable (curve) : aas::bakeControllerTable (curve);
+    }
+
+    bool isUsable() const noexcept { return usable; }
+
+    /** Add a block's matching events to the batch, to be remapped by apply() */
+    void gather(aas::ByteRemapBatch& batch, MidiBuffer& block) const {
+        if (velocity)
+            batch.gatherVelocities (block);
+        else
+            batch.gatherControllers (block, inputController, outputController);
+    }
+
+    void apply(aas::ByteRemapBatch& batch) const noexcept { batch.apply (table); }
+
+private:
+    aas::ByteTable table;
+    bool velocity = false, usable = false;
+    int inputController = 0, outputController = 0;
+};
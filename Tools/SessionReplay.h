@@ -0,0 +1,127 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:                  SessionReplay
+ version:               1.0.0
+ vendor:                JUCE
+ website:               http://juce.com
+ description:           Replays a captured MIDI-Transformer session and reports per-block timing.
+
+ dependencies:          juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                        juce_audio_processors, juce_audio_utils, juce_core,
+                        juce_data_structures, juce_events, juce_graphics,
+                        juce_gui_basics, juce_gui_extra
+ exporters:             xcode_mac, vs2019, linux_make
+
+ moduleFlags:           JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:                  Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include <iomanip>
+#include "../Source/MidiTransformerPlugin.h"
+
+/**
+ * Feeds a capture log (see aas::MidiCapture) back through a fresh processor, using the recorded state, block sizes,
+ * and each block's program and routing, as fast as it will go.
+ *
+ * Usage: SessionReplay <capture.mtcap> [--repeat N] [--per-block]
+ *
+ * Prints a summary of per-block processing time and, with --per-block, one CSV line per block. Output is compared
+ * byte-for-byte against what was captured live, so a replay also flags any change in behaviour.
+ */
+int main(int argc, char* argv[]) {
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args (argv + 1, argc - 1);
+    if (args.isEmpty()) {
+        std::cout << "Usage: SessionReplay <capture.mtcap> [--repeat N] [--per-block]" << std::endl;
+        return 1;
+    }
+
+    aas::CapturedSession session;
+    const auto loadResult = session.load (File::getCurrentWorkingDirectory().getChildFile (args[0]));
+    if (loadResult.failed()) {
+        std::cerr << loadResult.getErrorMessage() << std::endl;
+        return 1;
+    }
+    if (session.truncated)
+        std::cerr << "The log ends partway through a record; its last block is replayed but not compared" << std::endl;
+
+    const int repeatIndex = args.indexOf ("--repeat");
+    const int repeats = repeatIndex > 0 ? jmax (1, args[repeatIndex + 1].getIntValue()) : 1;
+    const bool perBlock = args.contains ("--per-block");
+
+    int maxBlockSize = 0;
+    for (const auto& block : session.blocks)
+        maxBlockSize = jmax (maxBlockSize, block.numSamples);
+
+    MidiTransformerPluginProcessor processor;
+    processor.setStateInformation (session.state.getData(), static_cast<int> (session.state.getSize()));
+    processor.prepareToPlay (session.sampleRate, maxBlockSize);
+
+    AudioBuffer<float> audio (processor.getTotalNumOutputChannels(), maxBlockSize);
+    MidiBuffer midi;
+    std::vector<double> blockSeconds;
+    blockSeconds.reserve (session.blocks.size() * static_cast<size_t> (repeats));
+    int64 totalSamples = 0;
+    int mismatchedBlocks = 0;
+
+    if (perBlock)
+        std::cout << "pass,block,samples,events,microseconds" << std::endl;
+
+    for (int pass = 0; pass < repeats; pass++) {
+        for (size_t i = 0; i < session.blocks.size(); i++) {
+            const auto& block = session.blocks[i];
+            audio.setSize (audio.getNumChannels(), block.numSamples, false, false, true);
+            audio.clear();
+            midi = block.input;
+            processor.setCapturedRouting (block.program, block.midiInputId, block.midiOutputId);
+
+            const auto start = Time::getHighResolutionTicks();
+            processor.processBlock (audio, midi);
+            const auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+            blockSeconds.push_back (seconds);
+            totalSamples += block.numSamples;
+            const bool complete = !session.truncated || i + 1 < session.blocks.size();
+            if (pass == 0 && complete && midi.data != block.output.data)
+                mismatchedBlocks++;
+
+            if (perBlock)
+                std::cout << pass << "," << i << "," << block.numSamples << "," << block.input.getNumEvents() << ","
+                          << seconds * 1.0e6 << std::endl;
+        }
+    }
+
+    processor.releaseResources();
+
+    if (blockSeconds.empty()) {
+        std::cout << "No blocks were captured" << std::endl;
+        return 0;
+    }
+
+    const double totalSeconds = std::accumulate (blockSeconds.begin(), blockSeconds.end(), 0.0);
+    std::sort (blockSeconds.begin(), blockSeconds.end());
+    auto percentile = [&blockSeconds](double p)
+    {
+        return blockSeconds[static_cast<size_t> (p * static_cast<double> (blockSeconds.size() - 1))] * 1.0e6;
+    };
+
+    std::cout << std::fixed << std::setprecision (2)
+              << "blocks:            " << blockSeconds.size() << std::endl
+              << "dropped in capture: " << session.droppedEvents << std::endl
+              << "per block (us):    p50 " << percentile (0.5) << "  p99 " << percentile (0.99) << "  max " << percentile (1.0) << std::endl
+              << "speed:             " << (static_cast<double> (totalSamples) / session.sampleRate) / totalSeconds << "x realtime" << std::endl
+              << "output mismatches: " << mismatchedBlocks << " of " << session.blocks.size() << " blocks" << std::endl;
+
+    return mismatchedBlocks == 0 ? 0 : 2;
+}